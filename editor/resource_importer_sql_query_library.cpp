@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "resource_importer_sql_query_library.h"
+
+#include "core/io/file_access.h"
+#include "core/io/resource_saver.h"
+#include "modules/sqlite_binding/sql_query_library.h"
+#include "modules/sqlite_binding/sqlite_binding.h"
+
+String ResourceImporterSQLQueryLibrary::get_importer_name() const {
+    return "sql_query_library";
+}
+
+String ResourceImporterSQLQueryLibrary::get_visible_name() const {
+    return "SQL Query Library";
+}
+
+void ResourceImporterSQLQueryLibrary::get_recognized_extensions(List<String>* p_extensions) const {
+    // Not .sql, so that schema and migration scripts are left alone.
+    p_extensions->push_back("sqllib");
+}
+
+String ResourceImporterSQLQueryLibrary::get_save_extension() const {
+    return "res";
+}
+
+String ResourceImporterSQLQueryLibrary::get_resource_type() const {
+    return "SQLQueryLibrary";
+}
+
+int ResourceImporterSQLQueryLibrary::get_preset_count() const {
+    return 0;
+}
+
+String ResourceImporterSQLQueryLibrary::get_preset_name(int p_idx) const {
+    return String();
+}
+
+void ResourceImporterSQLQueryLibrary::get_import_options(const String& p_path, List<ImportOption>* r_options,
+        int p_preset) const {
+    r_options->push_back(ImportOption(PropertyInfo(Variant::STRING, "schema", PROPERTY_HINT_FILE, "*.sqlite,*.db,*.sql"), ""));
+}
+
+bool ResourceImporterSQLQueryLibrary::get_option_visibility(const String& p_path, const String& p_option,
+        const HashMap<StringName, Variant>& p_options) const {
+    return true;
+}
+
+Error ResourceImporterSQLQueryLibrary::import(const String& p_source_file, const String& p_save_path,
+        const HashMap<StringName, Variant>& p_options, List<String>* r_platform_variants, List<String>* r_gen_files,
+        Variant* r_metadata) {
+    Error err = OK;
+    const String source = FileAccess::get_file_as_string(p_source_file, &err);
+    ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot read " + p_source_file);
+
+    Ref<SQLQueryLibrary> library;
+    library.instantiate();
+    err = library->parse(source);
+    ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot parse " + p_source_file);
+
+    const String schema = p_options.has("schema") ? String(p_options["schema"]) : String();
+    if (!schema.is_empty()) {
+        // Queries are only prepared, never run, so the schema is left alone.
+        Ref<SQLiteBinding> db;
+        db.instantiate();
+        if (schema.get_extension().to_lower() == "sql") {
+            const String script = FileAccess::get_file_as_string(schema, &err);
+            ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot read schema " + schema);
+            ERR_FAIL_COND_V(!db->open(":memory:"), ERR_CANT_OPEN);
+            ERR_FAIL_COND_V_MSG(!db->execute_script(script), ERR_PARSE_ERROR, "Cannot run schema " + schema);
+        } else {
+            ERR_FAIL_COND_V_MSG(!FileAccess::exists(schema), ERR_FILE_NOT_FOUND, "Schema database not found: " + schema);
+            ERR_FAIL_COND_V_MSG(!db->open(schema), ERR_CANT_OPEN, "Cannot open schema " + schema);
+        }
+        db->set_query_library(library);
+        const bool valid = db->prepare_library();
+        db->close();
+        ERR_FAIL_COND_V_MSG(!valid, ERR_PARSE_ERROR, "Invalid queries in " + p_source_file);
+    }
+
+    return ResourceSaver::save(library, p_save_path + "." + get_save_extension());
+}
@@ -23,13 +23,48 @@
 #include "register_types.h"
 
 #include "core/object/class_db.h"
+#include "sql_query_library.h"
 #include "sqlite_binding.h"
+#include "sqlite_connection_manager.h"
+#include "sqlite_kv.h"
+#include "sqlite_live_query.h"
+#include "sqlite_row_set.h"
+#include "sqlite_shard_set.h"
+#include "sqlite_snapshot.h"
+#include "sqlite_unit_of_work.h"
+
+#ifdef TOOLS_ENABLED
+#include "core/config/engine.h"
+#include "core/io/resource_importer.h"
+#include "editor/resource_importer_sql_query_library.h"
+#endif
 
 void initialize_sqlite_binding_module(ModuleInitializationLevel p_level) {
     if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
         return;
     }
     ClassDB::register_class<SQLiteBinding>();
+    ClassDB::register_class<SQLiteConnectionManager>();
+    ClassDB::register_class<SQLiteKV>();
+    ClassDB::register_class<SQLiteLiveQuery>();
+    ClassDB::register_class<SQLiteRow>();
+    ClassDB::register_class<SQLiteRowSet>();
+    ClassDB::register_class<SQLiteShardSet>();
+    ClassDB::register_class<SQLiteSnapshot>();
+    ClassDB::register_class<SQLiteUnitOfWork>();
+    ClassDB::register_class<SQLQueryLibrary>();
+
+#ifdef TOOLS_ENABLED
+    if (Engine::get_singleton()->is_editor_hint()) {
+        Ref<ResourceImporterSQLQueryLibrary> sql_import;
+        sql_import.instantiate();
+        ResourceFormatImporter::get_singleton()->add_importer(sql_import);
+    }
+    ClassDB::APIType prev_api = ClassDB::get_current_api();
+    ClassDB::set_current_api(ClassDB::API_EDITOR);
+    ClassDB::register_class<ResourceImporterSQLQueryLibrary>();
+    ClassDB::set_current_api(prev_api);
+#endif
 }
 
 void uninitialize_sqlite_binding_module(ModuleInitializationLevel p_level) {
@@ -0,0 +1,93 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sql_query_library.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+
+void SQLQueryLibrary::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("parse", "source"), &SQLQueryLibrary::parse);
+    ClassDB::bind_method(D_METHOD("set_queries", "queries"), &SQLQueryLibrary::set_queries);
+    ClassDB::bind_method(D_METHOD("get_queries"), &SQLQueryLibrary::get_queries);
+    ClassDB::bind_method(D_METHOD("has_query", "name"), &SQLQueryLibrary::has_query);
+    ClassDB::bind_method(D_METHOD("get_query", "name"), &SQLQueryLibrary::get_query);
+    ClassDB::bind_method(D_METHOD("get_query_names"), &SQLQueryLibrary::get_query_names);
+
+    ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "queries"), "set_queries", "get_queries");
+}
+
+SQLQueryLibrary::SQLQueryLibrary() = default;
+
+Error SQLQueryLibrary::parse(const String& source) {
+    static const String marker = "-- name:";
+
+    Dictionary parsed;
+    String name;
+    String body;
+    const PackedStringArray lines = source.split("\n");
+    for (int i = 0; i <= lines.size(); ++i) {
+        const bool at_end = i == lines.size();
+        const String line = at_end ? String() : lines[i];
+        if (!at_end && !line.strip_edges().begins_with(marker)) {
+            if (!name.is_empty()) {
+                body += line + "\n";
+            }
+            continue;
+        }
+        if (!name.is_empty()) {
+            const String query = body.strip_edges();
+            ERR_FAIL_COND_V_MSG(query.is_empty(), ERR_PARSE_ERROR, "Query " + name + " is empty");
+            parsed[name] = query;
+        }
+        if (at_end) {
+            break;
+        }
+        name = line.strip_edges().substr(marker.length()).strip_edges();
+        body = String();
+        ERR_FAIL_COND_V_MSG(name.is_empty(), ERR_PARSE_ERROR, "Missing query name at line " + itos(i + 1));
+        ERR_FAIL_COND_V_MSG(parsed.has(name), ERR_PARSE_ERROR, "Duplicate query name: " + name);
+    }
+
+    queries = parsed;
+    emit_changed();
+    return OK;
+}
+
+void SQLQueryLibrary::set_queries(const Dictionary& p_queries) {
+    queries = p_queries;
+    emit_changed();
+}
+
+String SQLQueryLibrary::get_query(const String& name) const {
+    ERR_FAIL_COND_V_MSG(!queries.has(name), String(), "Unknown query: " + name);
+    return queries[name];
+}
+
+PackedStringArray SQLQueryLibrary::get_query_names() const {
+    PackedStringArray names;
+    const Array keys = queries.keys();
+    for (int i = 0; i < keys.size(); ++i) {
+        names.push_back(keys[i]);
+    }
+    return names;
+}
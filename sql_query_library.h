@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/io/resource.h"
+#include "core/variant/dictionary.h"
+
+// Named queries loaded from a .sqllib file made of blocks such as
+//
+//     -- name: get_player
+//     SELECT * FROM players WHERE id = ?;
+//
+// Each block holds exactly one statement. Connections prepare the queries
+// once and run them by name, see SQLiteBinding::run().
+class SQLQueryLibrary : public Resource {
+    GDCLASS(SQLQueryLibrary, Resource);
+
+    Dictionary queries;
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLQueryLibrary();
+
+    Error parse(const String& source);
+
+    void set_queries(const Dictionary& queries);
+    Dictionary get_queries() const { return queries; }
+
+    bool has_query(const String& name) const { return queries.has(name); }
+    String get_query(const String& name) const;
+    PackedStringArray get_query_names() const;
+};
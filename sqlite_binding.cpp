@@ -21,140 +21,535 @@
 // SOFTWARE.
 
 #include "sqlite_binding.h"
+#include "sqlite_checkpoint_log.h"
+#include "sqlite_compressed_vfs.h"
+#include "sqlite_table_mirror.h"
+#include "sqlite_overlay_vfs.h"
+#include "sqlite_row_set.h"
+#include "sqlite_utils.h"
+#include "sqlite_write_through.h"
 
 #include "core/error/error_macros.h"
+#include "core/io/dir_access.h"
 #include "core/object/class_db.h"
+#include "core/object/script_language.h"
+#include "core/os/os.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/hashfuncs.h"
+#include "core/templates/sort_array.h"
 #include "core/variant/array.h"
 #include "core/variant/dictionary.h"
 #include "core/variant/variant.h"
+#include "scene/main/scene_tree.h"
 #include "editor/project_settings_editor.h"
 
 #include <sqlite3.h>
+#include <cctype>
+extern "C" {
+#include <sqlite3expert.h>
+}
 
-[[nodiscard]] static sqlite3_stmt* prepare(sqlite3* db, const char* query) {
-    ERR_FAIL_COND_V(db == nullptr, nullptr);
-    sqlite3_stmt* stmt = nullptr;
-    int result = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
-    ERR_FAIL_COND_V(result != SQLITE_OK, nullptr);
-    return stmt;
+using namespace SQLiteUtils;
+
+void SQLiteBinding::_update_hook(void* user_data, int operation, const char* database, const char* table,
+        long long rowid) {
+    SQLiteBinding* self = static_cast<SQLiteBinding*>(user_data);
+    for (SQLiteUpdateListener* listener : self->update_listeners) {
+        listener->on_row_updated(operation, table, rowid);
+    }
 }
 
-static bool bind_args(sqlite3_stmt* stmt, const Array& args) {
-    const int param_count = sqlite3_bind_parameter_count(stmt);
-    if (param_count != args.size()) {
-        print_error("Failed to bind arguments [Wrong Count]: expected " + itos(param_count) +
-            ", got " + itos(args.size()));
-        return false;
+void SQLiteBinding::_rollback_hook(void* user_data) {
+    SQLiteBinding* self = static_cast<SQLiteBinding*>(user_data);
+    for (SQLiteUpdateListener* listener : self->update_listeners) {
+        listener->on_rollback();
     }
+}
 
-    for (int i = 0; i < param_count; ++i) {
-        int result = SQLITE_OK;
-        const Variant::Type type = args[i].get_type();
-        switch (type) {
-        case Variant::Type::PACKED_BYTE_ARRAY:
-        {
-            const PackedByteArray blob = args[i];
-            result = sqlite3_bind_blob(stmt, i + 1, blob.ptr(), blob.size(), SQLITE_TRANSIENT);
-            break;
-        }
-        case Variant::Type::FLOAT:
-            result = sqlite3_bind_double(stmt, i + 1, static_cast<double>(args[i]));
-            break;
-        case Variant::Type::INT:
-            result = sqlite3_bind_int(stmt, i + 1, static_cast<int>(args[i]));
-            break;
-        case Variant::Type::NIL:
-            result = sqlite3_bind_null(stmt, i + 1);
-            break;
-        case Variant::Type::STRING:
-            result = sqlite3_bind_text(stmt, i + 1, String(args[i]).utf8().get_data(), -1, SQLITE_TRANSIENT);
-            break;
-        default:
-            print_error("Unsupported type: " + itos(type));
-            return false;
-        }
+static const char* next_word(const char* sql, int& r_length) {
+    while (isspace(static_cast<unsigned char>(*sql))) {
+        sql++;
+    }
+    r_length = 0;
+    while (isalpha(static_cast<unsigned char>(sql[r_length]))) {
+        r_length++;
+    }
+    return sql;
+}
 
-        if (result != SQLITE_OK) {
-            print_error(
-                "Failed to bind argument at [" + itos(i + 1) +
-                "] with type " + itos(type) +
-                ", error code = " + itos(result)
-            );
-            return false;
-        }
+// Whether `sql` is ROLLBACK [TRANSACTION] TO [SAVEPOINT] name.
+static bool is_rollback_to(const char* sql) {
+    int length = 0;
+    const char* word = next_word(sql, length);
+    if (length != 8 || sqlite3_strnicmp(word, "ROLLBACK", 8) != 0) {
+        return false;
     }
-    return true;
+    word = next_word(word + length, length);
+    if (length == 11 && sqlite3_strnicmp(word, "TRANSACTION", 11) == 0) {
+        word = next_word(word + length, length);
+    }
+    return length == 2 && sqlite3_strnicmp(word, "TO", 2) == 0;
 }
 
-[[nodiscard]] static Dictionary fetch_row(sqlite3_stmt* stmt) {
-    Dictionary result;
-    const int column_count = sqlite3_column_count(stmt);
-    for (int i = 0; i < column_count; ++i) {
-        const char* name = sqlite3_column_name(stmt, i);
-        const int type = sqlite3_column_type(stmt, i);
-        switch (type) {
-        case SQLITE_INTEGER:
-            result[name] = sqlite3_column_int(stmt, i);
-            break;
-        case SQLITE_FLOAT:
-            result[name] = sqlite3_column_double(stmt, i);
-            break;
-        case SQLITE_TEXT:
-            result[name] = String(reinterpret_cast<const char*>(sqlite3_column_text(stmt, i)));
-            break;
-        case SQLITE_BLOB:
-        {
-            PackedByteArray arr;
-            const int size = sqlite3_column_bytes(stmt, i);
-            arr.resize(size);
-            memcpy((void*)arr.ptr(), sqlite3_column_blob(stmt, i), size);
-            result[name] = arr;
-            break;
+// ROLLBACK TO undoes changes without calling the rollback hook, so listeners
+// are told from the statement trace instead.
+int SQLiteBinding::_trace(unsigned int type, void* user_data, void* stmt, void* sql) {
+    SQLiteBinding* self = static_cast<SQLiteBinding*>(user_data);
+    if (self->update_listeners.is_empty() || !is_rollback_to(static_cast<const char*>(sql))) {
+        return 0;
+    }
+    for (SQLiteUpdateListener* listener : self->update_listeners) {
+        listener->on_rollback();
+    }
+    return 0;
+}
+
+int SQLiteBinding::_authorize(void* user_data, int action, const char* arg1, const char* arg2,
+        const char* database, const char* trigger) {
+    SQLiteBinding* self = static_cast<SQLiteBinding*>(user_data);
+    if (self->user_authorizer != nullptr) {
+        const int result = self->user_authorizer(self->user_authorizer_data, action, arg1, arg2, database, trigger);
+        if (result != SQLITE_OK) {
+            return result;
         }
-        case SQLITE_NULL:
-            break;
-        default:
-            print_error("Unsupported column type: " + itos(type));
-            return {};
+    }
+    if (arg1 == nullptr) {
+        return SQLITE_OK;
+    }
+    if (action == SQLITE_READ && self->read_tables != nullptr) {
+        self->read_tables->insert(String::utf8(arg1));
+    } else if (action == SQLITE_DELETE) {
+        // SQLITE_IGNORE keeps the delete but turns off the truncate
+        // optimization, which would skip the update hook.
+        for (const SQLiteUpdateListener* listener : self->update_listeners) {
+            if (listener->watches_table(arg1)) {
+                return SQLITE_IGNORE;
+            }
         }
     }
-    return result;
+    return SQLITE_OK;
 }
 
 void SQLiteBinding::_bind_methods() {
     ClassDB::bind_method(D_METHOD("open", "path"), &SQLiteBinding::open);
+    ClassDB::bind_method(D_METHOD("open_overlay", "base_path", "delta_path"), &SQLiteBinding::open_overlay);
+    ClassDB::bind_method(D_METHOD("open_memory_resident", "path", "persist_interval_msec"),
+        &SQLiteBinding::open_memory_resident, DEFVAL(1000));
+    ClassDB::bind_method(D_METHOD("persist"), &SQLiteBinding::persist);
+    ClassDB::bind_method(D_METHOD("open_compressed", "path", "read_only", "compression_mode"), &SQLiteBinding::open_compressed,
+        DEFVAL(false), DEFVAL(FileAccess::COMPRESSION_ZSTD));
+    ClassDB::bind_method(D_METHOD("save_compressed", "path", "compression_mode"), &SQLiteBinding::save_compressed,
+        DEFVAL(FileAccess::COMPRESSION_ZSTD));
+    ClassDB::bind_method(D_METHOD("open_async", "path", "options"), &SQLiteBinding::open_async, DEFVAL(Dictionary()));
+    ClassDB::bind_method(D_METHOD("is_opening"), &SQLiteBinding::is_opening);
     ClassDB::bind_method(D_METHOD("close"), &SQLiteBinding::close);
     ClassDB::bind_method(D_METHOD("query", "query"), &SQLiteBinding::query);
     ClassDB::bind_method(D_METHOD("query_with_args", "query", "arguments"), &SQLiteBinding::query_with_args);
+    ClassDB::bind_method(D_METHOD("execute_script", "script"), &SQLiteBinding::execute_script);
     ClassDB::bind_method(D_METHOD("query_fetch_rows", "query"), &SQLiteBinding::query_fetch_rows);
     ClassDB::bind_method(D_METHOD("query_fetch_rows_with_args", "query", "arguments"), &SQLiteBinding::query_fetch_rows_with_args);
+    ClassDB::bind_method(D_METHOD("query_fetch_row_set", "query", "arguments"), &SQLiteBinding::query_fetch_row_set, DEFVAL(Array()));
+    ClassDB::bind_method(D_METHOD("query_into_float_buffer", "query", "arguments", "layout"), &SQLiteBinding::query_into_float_buffer);
+    ClassDB::bind_method(D_METHOD("query_fetch_columns", "query", "arguments", "dictionary_columns"), &SQLiteBinding::query_fetch_columns, DEFVAL(Array()), DEFVAL(PackedStringArray()));
+    ClassDB::bind_method(D_METHOD("insert_columns", "table", "columns", "sort_by_column"), &SQLiteBinding::insert_columns, DEFVAL(String()));
+    ClassDB::bind_method(D_METHOD("mirror_table", "table", "key_column"), &SQLiteBinding::mirror_table);
+    ClassDB::bind_method(D_METHOD("mirror_get", "table", "key"), &SQLiteBinding::mirror_get);
+    ClassDB::bind_method(D_METHOD("unmirror_table", "table"), &SQLiteBinding::unmirror_table);
+    ClassDB::bind_method(D_METHOD("enable_checkpoints", "max_checkpoints"), &SQLiteBinding::enable_checkpoints);
+    ClassDB::bind_method(D_METHOD("checkpoint"), &SQLiteBinding::checkpoint);
+    ClassDB::bind_method(D_METHOD("rollback_to_checkpoint", "id"), &SQLiteBinding::rollback_to_checkpoint);
+    ClassDB::bind_method(D_METHOD("get_oldest_checkpoint"), &SQLiteBinding::get_oldest_checkpoint);
+    ClassDB::bind_method(D_METHOD("get_latest_checkpoint"), &SQLiteBinding::get_latest_checkpoint);
+    ClassDB::bind_method(D_METHOD("snapshot_get"), &SQLiteBinding::snapshot_get);
+    ClassDB::bind_method(D_METHOD("snapshot_open", "snapshot"), &SQLiteBinding::snapshot_open);
+    ClassDB::bind_method(D_METHOD("snapshot_close"), &SQLiteBinding::snapshot_close);
+    ClassDB::bind_method(D_METHOD("set_query_library", "library"), &SQLiteBinding::set_query_library);
+    ClassDB::bind_method(D_METHOD("get_query_library"), &SQLiteBinding::get_query_library);
+    ClassDB::bind_method(D_METHOD("prepare_library"), &SQLiteBinding::prepare_library);
+    ClassDB::bind_method(D_METHOD("run", "name", "arguments"), &SQLiteBinding::run, DEFVAL(Array()));
+    ClassDB::bind_method(D_METHOD("recommend_indexes", "queries"), &SQLiteBinding::recommend_indexes);
+    ClassDB::bind_method(D_METHOD("optimize"), &SQLiteBinding::optimize);
+    ClassDB::bind_method(D_METHOD("optimize_async"), &SQLiteBinding::optimize_async);
+    ClassDB::bind_method(D_METHOD("set_blob_compression_mode", "mode"), &SQLiteBinding::set_blob_compression_mode);
+    ClassDB::bind_method(D_METHOD("get_blob_compression_mode"), &SQLiteBinding::get_blob_compression_mode);
+    ClassDB::bind_method(D_METHOD("set_blob_compression_threshold", "bytes"), &SQLiteBinding::set_blob_compression_threshold);
+    ClassDB::bind_method(D_METHOD("get_blob_compression_threshold"), &SQLiteBinding::get_blob_compression_threshold);
+    ClassDB::bind_method(D_METHOD("set_optimize_on_close", "enabled"), &SQLiteBinding::set_optimize_on_close);
+    ClassDB::bind_method(D_METHOD("get_optimize_on_close"), &SQLiteBinding::get_optimize_on_close);
+    ClassDB::bind_method(D_METHOD("set_optimize_interval", "msec"), &SQLiteBinding::set_optimize_interval);
+    ClassDB::bind_method(D_METHOD("get_optimize_interval"), &SQLiteBinding::get_optimize_interval);
+    ClassDB::bind_method(D_METHOD("set_analysis_limit", "limit"), &SQLiteBinding::set_analysis_limit);
+    ClassDB::bind_method(D_METHOD("get_analysis_limit"), &SQLiteBinding::get_analysis_limit);
+    ClassDB::bind_method(D_METHOD("export_planner_stats"), &SQLiteBinding::export_planner_stats);
+    ClassDB::bind_method(D_METHOD("load_planner_stats", "stats"), &SQLiteBinding::load_planner_stats);
+    ClassDB::bind_method(D_METHOD("set_worker_threads", "count"), &SQLiteBinding::set_worker_threads);
+    ClassDB::bind_method(D_METHOD("get_worker_threads"), &SQLiteBinding::get_worker_threads);
+    ClassDB::bind_method(D_METHOD("set_temp_store", "mode"), &SQLiteBinding::set_temp_store);
+    ClassDB::bind_method(D_METHOD("set_cache_size", "kib"), &SQLiteBinding::set_cache_size);
+    ClassDB::bind_method(D_METHOD("query_fetch_objects", "query", "arguments", "class_name_or_script"), &SQLiteBinding::query_fetch_objects);
+
+    ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "query_library", PROPERTY_HINT_RESOURCE_TYPE, "SQLQueryLibrary"), "set_query_library", "get_query_library");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "blob_compression_mode", PROPERTY_HINT_ENUM, "None:-1,FastLZ:0,Deflate:1,Zstd:2,GZip:3"),
+        "set_blob_compression_mode", "get_blob_compression_mode");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "blob_compression_threshold", PROPERTY_HINT_NONE, "suffix:B"),
+        "set_blob_compression_threshold", "get_blob_compression_threshold");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "optimize_on_close"), "set_optimize_on_close", "get_optimize_on_close");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "optimize_interval"), "set_optimize_interval", "get_optimize_interval");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "analysis_limit"), "set_analysis_limit", "get_analysis_limit");
+
+    ADD_SIGNAL(MethodInfo("opened", PropertyInfo(Variant::BOOL, "success")));
+    ADD_SIGNAL(MethodInfo("optimized"));
+
+    BIND_ENUM_CONSTANT(TEMP_STORE_DEFAULT);
+    BIND_ENUM_CONSTANT(TEMP_STORE_FILE);
+    BIND_ENUM_CONSTANT(TEMP_STORE_MEMORY);
 }
 
+struct SQLiteBinding::OpenTask {
+    SQLiteBinding* owner = nullptr;
+    String path;
+    PackedStringArray statements;
+    PackedStringArray warm;
+    int64_t mmap_size = -1;
+
+    sqlite3* db = nullptr;
+    HashMap<String, sqlite3_stmt*> prepared;
+};
+
 SQLiteBinding::SQLiteBinding() = default;
 SQLiteBinding::~SQLiteBinding() {
+    _wait_for_optimize();
+    if (open_task != nullptr) {
+        // Nobody is left to receive `opened`, drop the connection.
+        WorkerThreadPool::get_singleton()->wait_for_task_completion(open_task_id);
+        for (const KeyValue<String, sqlite3_stmt*>& E : open_task->prepared) {
+            sqlite3_finalize(E.value);
+        }
+        sqlite3_close(open_task->db);
+        memdelete(open_task);
+        open_task = nullptr;
+    }
     if (db_ctx) {
         close();
     }
 }
 
+void SQLiteBinding::_attach(sqlite3* db, const String& real_path) {
+    db_ctx = db;
+    sqlite3_update_hook(db_ctx, &SQLiteBinding::_update_hook, this);
+    sqlite3_rollback_hook(db_ctx, &SQLiteBinding::_rollback_hook, this);
+    sqlite3_trace_v2(db_ctx, SQLITE_TRACE_STMT, &SQLiteBinding::_trace, this);
+    sqlite3_set_authorizer(db_ctx, &SQLiteBinding::_authorize, this);
+    db_path = real_path;
+    last_optimize_usec = OS::get_singleton()->get_ticks_usec();
+    register_blob_functions(db_ctx);
+    set_blob_compression(db_ctx, blob_compression_mode, blob_compression_threshold);
+}
+
+void SQLiteBinding::set_blob_compression_mode(int mode) {
+    ERR_FAIL_COND_MSG(mode == FileAccess::COMPRESSION_BROTLI, "Brotli can only decompress");
+    blob_compression_mode = mode < 0 ? -1 : mode;
+    if (db_ctx != nullptr) {
+        set_blob_compression(db_ctx, blob_compression_mode, blob_compression_threshold);
+    }
+}
+
+void SQLiteBinding::set_blob_compression_threshold(int bytes) {
+    blob_compression_threshold = MAX(bytes, 0);
+    if (db_ctx != nullptr) {
+        set_blob_compression(db_ctx, blob_compression_mode, blob_compression_threshold);
+    }
+}
+
 bool SQLiteBinding::open(const String& path) {
     if (!path.strip_edges().length()) {
         return false;
     }
+    ERR_FAIL_COND_V_MSG(open_task != nullptr, false, "Database is being opened asynchronously");
     const String real_path = ProjectSettings::get_singleton()->globalize_path(path.strip_edges());
-    if (sqlite3_open_v2(real_path.utf8().get_data(), &db_ctx,
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(real_path.utf8().get_data(), &db,
             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
         print_error("Failed to open database");
         return false;
     }
+    _attach(db, real_path);
+    return true;
+}
+
+// The overlay and compressed VFSs index their file once at open, so only one
+// connection may use it at a time. Exclusive locking mode keeps the write
+// lock taken here until the connection closes; a second connection, in this
+// process or another, fails here instead of working from a stale index.
+static bool lock_exclusively(sqlite3* db) {
+    return sqlite3_exec(db, "PRAGMA locking_mode = EXCLUSIVE; BEGIN EXCLUSIVE; COMMIT", nullptr, nullptr, nullptr) ==
+        SQLITE_OK;
+}
+
+// Opens `base_path` read-only (res:// and PCK paths work) with every change
+// stored in `delta_path`, so the base never has to be copied to user://.
+// The delta stays locked until close().
+bool SQLiteBinding::open_overlay(const String& base_path, const String& delta_path) {
+    ERR_FAIL_COND_V(base_path.strip_edges().is_empty() || delta_path.strip_edges().is_empty(), false);
+    ERR_FAIL_COND_V_MSG(open_task != nullptr, false, "Database is being opened asynchronously");
+    ERR_FAIL_COND_V_MSG(!FileAccess::exists(base_path), false, "Base database not found: " + base_path);
+    const String uri = SQLiteOverlayVFS::make_uri(
+        ProjectSettings::get_singleton()->globalize_path(delta_path.strip_edges()), base_path.strip_edges());
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(uri.utf8().get_data(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+            SQLiteOverlayVFS::get_name()) != SQLITE_OK) {
+        print_error("Failed to open overlay database: " + String::utf8(sqlite3_errmsg(db)));
+        sqlite3_close(db);
+        return false;
+    }
+    if (!lock_exclusively(db)) {
+        if (sqlite3_errcode(db) == SQLITE_BUSY) {
+            print_error("Overlay delta is already open on another connection: " + delta_path);
+        } else {
+            print_error("Failed to lock overlay database: " + String::utf8(sqlite3_errmsg(db)));
+        }
+        sqlite3_close(db);
+        return false;
+    }
+    _attach(db, uri);
+    return true;
+}
+
+// Loads the database at `path` into memory and serves every query from
+// there. Committed changes are written back to the file in the background
+// at most `persist_interval_msec` later, and on persist() and close().
+bool SQLiteBinding::open_memory_resident(const String& path, int persist_interval_msec) {
+    ERR_FAIL_COND_V(path.strip_edges().is_empty(), false);
+    ERR_FAIL_COND_V_MSG(open_task != nullptr, false, "Database is being opened asynchronously");
+    const String real_path = ProjectSettings::get_singleton()->globalize_path(path.strip_edges());
+    sqlite3* disk = nullptr;
+    sqlite3* memory = nullptr;
+    bool ok = sqlite3_open_v2(real_path.utf8().get_data(), &disk, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        nullptr) == SQLITE_OK;
+    ok = ok && sqlite3_open(":memory:", &memory) == SQLITE_OK;
+    if (ok) {
+        sqlite3_backup* load = sqlite3_backup_init(memory, "main", disk, "main");
+        ok = load != nullptr;
+        if (ok) {
+            sqlite3_backup_step(load, -1);
+            ok = sqlite3_backup_finish(load) == SQLITE_OK;
+        }
+    }
+    if (!ok) {
+        print_error("Failed to load database into memory: " + String::utf8(sqlite3_errmsg(memory ? memory : disk)));
+        sqlite3_close(memory);
+        sqlite3_close(disk);
+        return false;
+    }
+    _attach(memory, ":memory:");
+    write_through = memnew(SQLiteWriteThrough(memory, disk, persist_interval_msec));
+    if (!write_through->start()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteBinding::persist() {
+    ERR_FAIL_NULL_V_MSG(write_through, false, "Database is not memory resident");
+    return write_through->persist();
+}
+
+// Opens a database written by save_compressed() or by a previous writable
+// open_compressed(). Read-only databases may be in res:// or a PCK.
+// `compression_mode` only applies to pages written from now on in a new file;
+// existing files keep the mode they were created with. A writable database
+// stays locked until close(); read-only opens take no locks and must not be
+// used on a file that is being written.
+bool SQLiteBinding::open_compressed(const String& path, bool read_only, int compression_mode) {
+    ERR_FAIL_COND_V(path.strip_edges().is_empty(), false);
+    ERR_FAIL_COND_V_MSG(open_task != nullptr, false, "Database is being opened asynchronously");
+    ERR_FAIL_COND_V_MSG(compression_mode == FileAccess::COMPRESSION_BROTLI, false, "Brotli can only decompress");
+    String uri;
+    int flags = SQLITE_OPEN_URI;
+    if (read_only) {
+        ERR_FAIL_COND_V_MSG(!FileAccess::exists(path), false, "Database not found: " + path);
+        uri = SQLiteCompressedVFS::make_read_only_uri(path.strip_edges());
+        flags |= SQLITE_OPEN_READONLY;
+    } else {
+        uri = SQLiteCompressedVFS::make_uri(ProjectSettings::get_singleton()->globalize_path(path.strip_edges()),
+            Compression::Mode(compression_mode));
+        flags |= SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    }
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(uri.utf8().get_data(), &db, flags, SQLiteCompressedVFS::get_name()) != SQLITE_OK) {
+        print_error("Failed to open compressed database: " + String::utf8(sqlite3_errmsg(db)));
+        sqlite3_close(db);
+        return false;
+    }
+    if (!read_only && !lock_exclusively(db)) {
+        if (sqlite3_errcode(db) == SQLITE_BUSY) {
+            print_error("Compressed database is already open on another connection: " + path);
+        } else {
+            print_error("Failed to lock compressed database: " + String::utf8(sqlite3_errmsg(db)));
+        }
+        sqlite3_close(db);
+        return false;
+    }
+    _attach(db, uri);
+    return true;
+}
+
+// Writes a compressed copy of this database to `path`, e.g. to ship content
+// that is then opened with open_compressed(path, true).
+bool SQLiteBinding::save_compressed(const String& path, int compression_mode) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V_MSG(compression_mode == FileAccess::COMPRESSION_BROTLI, false, "Brotli can only decompress");
+    const String real_path = ProjectSettings::get_singleton()->globalize_path(path.strip_edges());
+    if (FileAccess::exists(real_path)) {
+        // Start from an empty file instead of rewriting an older copy in place.
+        Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+        ERR_FAIL_COND_V_MSG(dir->remove(real_path) != OK, false, "Cannot replace " + path);
+    }
+    const String uri = SQLiteCompressedVFS::make_uri(real_path, Compression::Mode(compression_mode));
+    sqlite3* target = nullptr;
+    if (sqlite3_open_v2(uri.utf8().get_data(), &target, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+            SQLiteCompressedVFS::get_name()) != SQLITE_OK) {
+        print_error("Failed to create compressed database: " + String::utf8(sqlite3_errmsg(target)));
+        sqlite3_close(target);
+        return false;
+    }
+    if (!lock_exclusively(target)) {
+        print_error("Failed to lock compressed database: " + String::utf8(sqlite3_errmsg(target)));
+        sqlite3_close(target);
+        return false;
+    }
+    sqlite3_backup* backup = sqlite3_backup_init(target, "main", db_ctx, "main");
+    bool ok = backup != nullptr;
+    if (ok) {
+        sqlite3_backup_step(backup, -1);
+        ok = sqlite3_backup_finish(backup) == SQLITE_OK;
+    }
+    if (!ok) {
+        print_error("Failed to save compressed database: " + String::utf8(sqlite3_errmsg(target)));
+    }
+    sqlite3_close(target);
+    return ok;
+}
+
+void SQLiteBinding::_open_task(void* user_data) {
+    OpenTask* task = static_cast<OpenTask*>(user_data);
+    if (sqlite3_open_v2(task->path.utf8().get_data(), &task->db,
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        sqlite3_close(task->db);
+        task->db = nullptr;
+    } else {
+        if (task->mmap_size >= 0) {
+            sqlite3_exec(task->db, ("PRAGMA mmap_size = " + itos(task->mmap_size)).utf8().get_data(), nullptr, nullptr, nullptr);
+        }
+        // Reading the schema table parses the whole schema.
+        sqlite3_exec(task->db, "SELECT count(*) FROM sqlite_schema", nullptr, nullptr, nullptr);
+
+        for (const String& query : task->statements) {
+            sqlite3_stmt* stmt = prepare(task->db, query.utf8().get_data());
+            if (stmt != nullptr) {
+                task->prepared.insert(query, stmt);
+            }
+        }
+
+        // Scanning a table or index pulls its pages into the page cache (and
+        // the OS cache, or the mapped region when mmap is on).
+        for (const String& name : task->warm) {
+            sqlite3_stmt* lookup = prepare(task->db, "SELECT type, tbl_name FROM sqlite_schema WHERE name = ?");
+            if (lookup == nullptr) {
+                break;
+            }
+            String scan;
+            const CharString utf8 = name.utf8();
+            sqlite3_bind_text(lookup, 1, utf8.get_data(), utf8.length(), SQLITE_STATIC);
+            if (sqlite3_step(lookup) == SQLITE_ROW) {
+                const String type = reinterpret_cast<const char*>(sqlite3_column_text(lookup, 0));
+                const String table = String::utf8(reinterpret_cast<const char*>(sqlite3_column_text(lookup, 1)));
+                if (type == "index") {
+                    scan = "SELECT count(*) FROM " + quote_identifier(table) + " INDEXED BY " + quote_identifier(name);
+                } else if (type == "table") {
+                    scan = "SELECT * FROM " + quote_identifier(name);
+                }
+            }
+            sqlite3_finalize(lookup);
+            if (scan.is_empty()) {
+                print_error("Nothing to warm up named " + name);
+                continue;
+            }
+            sqlite3_stmt* stmt = prepare(task->db, scan.utf8().get_data());
+            while (stmt != nullptr && sqlite3_step(stmt) == SQLITE_ROW) {
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    callable_mp(task->owner, &SQLiteBinding::_finish_open_async).call_deferred();
+}
+
+// Opens the database on a worker thread and emits `opened` when done.
+// Options:
+//   "statements" - queries to prepare into the statement cache
+//   "warm"       - tables or indexes to read into the page cache
+//   "mmap_size"  - PRAGMA mmap_size applied before warming up
+bool SQLiteBinding::open_async(const String& path, const Dictionary& options) {
+    ERR_FAIL_COND_V(path.strip_edges().is_empty(), false);
+    ERR_FAIL_COND_V_MSG(db_ctx != nullptr, false, "Database is already opened");
+    ERR_FAIL_COND_V_MSG(open_task != nullptr, false, "Database is being opened asynchronously");
+
+    open_task = memnew(OpenTask);
+    open_task->owner = this;
+    open_task->path = ProjectSettings::get_singleton()->globalize_path(path.strip_edges());
+    open_task->statements = options.get("statements", PackedStringArray());
+    open_task->warm = options.get("warm", PackedStringArray());
+    open_task->mmap_size = options.get("mmap_size", -1);
+    open_task_id = WorkerThreadPool::get_singleton()->add_native_task(&SQLiteBinding::_open_task, open_task, false,
+        "SQLiteBinding open");
     return true;
 }
 
+void SQLiteBinding::_finish_open_async() {
+    if (open_task == nullptr) {
+        return;
+    }
+    WorkerThreadPool::get_singleton()->wait_for_task_completion(open_task_id);
+    open_task_id = WorkerThreadPool::INVALID_TASK_ID;
+    OpenTask* task = open_task;
+    open_task = nullptr;
+
+    const bool success = task->db != nullptr;
+    if (success) {
+        _attach(task->db, task->path);
+        for (const KeyValue<String, sqlite3_stmt*>& E : task->prepared) {
+            statement_cache.insert(E.key, E.value);
+        }
+    } else {
+        print_error("Failed to open database");
+    }
+    memdelete(task);
+    emit_signal(SNAME("opened"), success);
+}
+
 bool SQLiteBinding::close() {
     if (!db_ctx) {
         print_error("Database is not opened");
         return false;
     }
+    _wait_for_optimize();
+    if (optimize_on_close) {
+        _run_optimize(db_ctx, analysis_limit);
+    }
+    clear_statement_cache();
+    _clear_mirrors();
+    reading_snapshot = false;
+    if (checkpoint_log != nullptr) {
+        memdelete(checkpoint_log);
+        checkpoint_log = nullptr;
+    }
+    if (write_through != nullptr) {
+        write_through->stop();
+        memdelete(write_through);
+        write_through = nullptr;
+    }
     if (sqlite3_close(db_ctx) != SQLITE_OK) {
         print_error("Failed to close database");
         return false;
@@ -163,53 +558,1387 @@ bool SQLiteBinding::close() {
     return true;
 }
 
-bool SQLiteBinding::query(const String& query) {
-    return query_with_args(query, Array());
+bool SQLiteBinding::_run_optimize(sqlite3* db, int limit) {
+    const String pragmas = "PRAGMA analysis_limit = " + itos(limit) + "; PRAGMA optimize;";
+    char* error = nullptr;
+    if (sqlite3_exec(db, pragmas.utf8().get_data(), nullptr, nullptr, &error) != SQLITE_OK) {
+        print_error("Failed to optimize database: " + String::utf8(error ? error : ""));
+        sqlite3_free(error);
+        return false;
+    }
+    return true;
 }
 
-bool SQLiteBinding::query_with_args(const String& query, const Array& arguments) {
-    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+void SQLiteBinding::_optimize_task(void* user_data) {
+    SQLiteBinding* self = static_cast<SQLiteBinding*>(user_data);
+    // A separate connection, so ANALYZE does not hold up queries on this one
+    // for longer than it holds the write lock.
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(self->db_path.utf8().get_data(), &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK) {
+        sqlite3_busy_timeout(db, 5000);
+        _run_optimize(db, self->analysis_limit);
+    }
+    sqlite3_close(db);
+    self->call_deferred(SNAME("emit_signal"), SNAME("optimized"));
+}
+
+void SQLiteBinding::_wait_for_optimize() {
+    if (optimize_task != WorkerThreadPool::INVALID_TASK_ID) {
+        WorkerThreadPool::get_singleton()->wait_for_task_completion(optimize_task);
+        optimize_task = WorkerThreadPool::INVALID_TASK_ID;
+    }
+}
+
+// Connected to SceneTree::process_frame while an optimize interval is set,
+// so connections that are only written to, or sit idle, are optimized too,
+// and never from inside a query call.
+void SQLiteBinding::_on_idle() {
+    if (db_ctx == nullptr || optimize_interval_msec <= 0) {
+        return;
+    }
+    const uint64_t now = OS::get_singleton()->get_ticks_usec();
+    if (now - last_optimize_usec >= static_cast<uint64_t>(optimize_interval_msec) * 1000) {
+        optimize_async();
+    }
+}
+
+void SQLiteBinding::_update_idle_hook() {
+    SceneTree* tree = Object::cast_to<SceneTree>(OS::get_singleton()->get_main_loop());
+    if (tree == nullptr) {
+        return;
+    }
+    const Callable callback = callable_mp(this, &SQLiteBinding::_on_idle);
+    // Connected for as long as an interval is set, not just while open:
+    // shards attach on worker threads, where SceneTree signals must not be
+    // touched, and _on_idle already skips closed connections.
+    const bool wanted = optimize_interval_msec > 0;
+    if (wanted && !tree->is_connected(SNAME("process_frame"), callback)) {
+        tree->connect(SNAME("process_frame"), callback);
+    } else if (!wanted && tree->is_connected(SNAME("process_frame"), callback)) {
+        tree->disconnect(SNAME("process_frame"), callback);
+    }
+}
+
+void SQLiteBinding::set_optimize_interval(int msec) {
+    optimize_interval_msec = msec;
+    _update_idle_hook();
+}
+
+void SQLiteBinding::_optimize_deferred() {
+    optimize_queued = false;
+    // Not in the middle of the caller's transaction; the next interval
+    // tries again.
+    if (db_ctx != nullptr && sqlite3_get_autocommit(db_ctx)) {
+        optimize();
+    }
+}
+
+bool SQLiteBinding::optimize() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    last_optimize_usec = OS::get_singleton()->get_ticks_usec();
+    const bool ok = _run_optimize(db_ctx, analysis_limit);
+    emit_signal(SNAME("optimized"));
+    return ok;
+}
+
+bool SQLiteBinding::optimize_async() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    if (optimize_task != WorkerThreadPool::INVALID_TASK_ID) {
+        if (!WorkerThreadPool::get_singleton()->is_task_completed(optimize_task)) {
+            return false;
+        }
+        _wait_for_optimize();
+    }
+    // In-memory databases and the custom VFS modes cannot be reached from a
+    // second connection: optimize this one, but only once the current
+    // call and the rest of the frame's deferred calls are done.
+    if (db_path.is_empty() || db_path == ":memory:" || db_path.begins_with("file:")) {
+        if (!optimize_queued) {
+            optimize_queued = true;
+            last_optimize_usec = OS::get_singleton()->get_ticks_usec();
+            callable_mp(this, &SQLiteBinding::_optimize_deferred).call_deferred();
+        }
+        return true;
+    }
+    last_optimize_usec = OS::get_singleton()->get_ticks_usec();
+    optimize_task = WorkerThreadPool::get_singleton()->add_native_task(&SQLiteBinding::_optimize_task, this, false,
+        "SQLiteBinding optimize");
+    return true;
+}
+
+static bool planner_table_exists(sqlite3* db, const char* table) {
+    sqlite3_stmt* stmt = prepare(db, "SELECT 1 FROM sqlite_schema WHERE type = 'table' AND name = ?");
     if (stmt == nullptr) {
         return false;
     }
-    if (!bind_args(stmt, arguments)) {
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    const bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+Dictionary SQLiteBinding::export_planner_stats() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, Dictionary());
+    Dictionary stats;
+    if (planner_table_exists(db_ctx, "sqlite_stat1")) {
+        stats["sqlite_stat1"] = query_fetch_rows("SELECT tbl, idx, stat FROM sqlite_stat1");
+    }
+    if (planner_table_exists(db_ctx, "sqlite_stat4")) {
+        stats["sqlite_stat4"] = query_fetch_rows("SELECT tbl, idx, neq, nlt, ndlt, sample FROM sqlite_stat4");
+    }
+    return stats;
+}
+
+bool SQLiteBinding::load_planner_stats(const Dictionary& stats) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+
+    struct StatTable {
+        const char* name;
+        const char* insert;
+        const char* columns[6];
+    };
+    static const StatTable tables[] = {
+        { "sqlite_stat1", "INSERT INTO sqlite_stat1 (tbl, idx, stat) VALUES (?, ?, ?)",
+            { "tbl", "idx", "stat", nullptr } },
+        { "sqlite_stat4", "INSERT INTO sqlite_stat4 (tbl, idx, neq, nlt, ndlt, sample) VALUES (?, ?, ?, ?, ?, ?)",
+            { "tbl", "idx", "neq", "nlt", "ndlt", "sample" } },
+    };
+
+    // Any ANALYZE creates the statistics tables; analyzing only the schema
+    // table is instant.
+    if (sqlite3_exec(db_ctx, "ANALYZE sqlite_schema; BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        print_error("Failed to prepare planner statistics: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        return false;
+    }
+    bool ok = true;
+    for (const StatTable& table : tables) {
+        if (!stats.has(table.name)) {
+            continue;
+        }
+        ERR_CONTINUE_MSG(!planner_table_exists(db_ctx, table.name), String("Statistics table is not available: ") + table.name);
+        ok = query(String("DELETE FROM ") + table.name);
+        sqlite3_stmt* stmt = ok ? prepare(db_ctx, table.insert) : nullptr;
+        ok = stmt != nullptr;
+        const Array rows = stats[table.name];
+        for (int r = 0; ok && r < rows.size(); ++r) {
+            const Dictionary row = rows[r];
+            for (int c = 0; ok && c < 6 && table.columns[c] != nullptr; ++c) {
+                const Variant value = row.get(table.columns[c], Variant());
+                if (value.get_type() == Variant::PACKED_BYTE_ARRAY) {
+                    // Samples are record images SQLite decodes itself: never
+                    // compressed, whatever the blob compression setting.
+                    const PackedByteArray sample = value;
+                    ok = sqlite3_bind_blob(stmt, c + 1, sample.ptr(), sample.size(), SQLITE_TRANSIENT) == SQLITE_OK;
+                } else {
+                    ok = bind_value(stmt, c + 1, value);
+                }
+            }
+            if (ok && sqlite3_step(stmt) != SQLITE_DONE) {
+                print_error("Failed to load planner statistics: " + String::utf8(sqlite3_errmsg(db_ctx)));
+                ok = false;
+            }
+            sqlite3_reset(stmt);
+        }
         sqlite3_finalize(stmt);
+        if (!ok) {
+            break;
+        }
+    }
+    if (!ok) {
+        sqlite3_exec(db_ctx, "ROLLBACK", nullptr, nullptr, nullptr);
         return false;
     }
-    sqlite3_step(stmt);
+    // Committing and analyzing the schema table again makes the planner
+    // reload the statistics.
+    return sqlite3_exec(db_ctx, "COMMIT; ANALYZE sqlite_schema", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+static PackedStringArray split_report(const char* report) {
+    PackedStringArray lines;
+    if (report == nullptr) {
+        return lines;
+    }
+    const PackedStringArray parts = String::utf8(report).split("\n", false);
+    for (const String& part : parts) {
+        const String line = part.strip_edges();
+        if (!line.is_empty()) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+static String explain_query_plan(sqlite3* db, const String& query) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, ("EXPLAIN QUERY PLAN " + query).utf8().get_data(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return String();
+    }
+    // The last column is the human readable detail of each plan step.
+    const int detail = sqlite3_column_count(stmt) - 1;
+    String plan;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        plan += String::utf8(reinterpret_cast<const char*>(sqlite3_column_text(stmt, detail))) + "\n";
+    }
     sqlite3_finalize(stmt);
+    return plan;
+}
+
+Dictionary SQLiteBinding::recommend_indexes(const PackedStringArray& queries) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, Dictionary());
+
+    char* error = nullptr;
+    sqlite3expert* expert = sqlite3_expert_new(db_ctx, &error);
+    if (expert == nullptr) {
+        print_error("Failed to start index analysis: " + String::utf8(error ? error : "out of memory"));
+        sqlite3_free(error);
+        return Dictionary();
+    }
+
+    bool ok = true;
+    for (int i = 0; ok && i < queries.size(); ++i) {
+        if (sqlite3_expert_sql(expert, queries[i].utf8().get_data(), &error) != SQLITE_OK) {
+            print_error("Failed to add query for index analysis: " + String::utf8(error ? error : ""));
+            ok = false;
+        }
+    }
+    if (ok && sqlite3_expert_analyze(expert, &error) != SQLITE_OK) {
+        print_error("Failed to analyze queries: " + String::utf8(error ? error : ""));
+        ok = false;
+    }
+    if (!ok) {
+        sqlite3_free(error);
+        sqlite3_expert_destroy(expert);
+        return Dictionary();
+    }
+
+    PackedStringArray all_indexes;
+    Array statements;
+    for (int i = 0; i < sqlite3_expert_count(expert); ++i) {
+        const String sql = String::utf8(sqlite3_expert_report(expert, i, EXPERT_REPORT_SQL)).strip_edges();
+        const PackedStringArray indexes = split_report(sqlite3_expert_report(expert, i, EXPERT_REPORT_INDEXES));
+        for (const String& index : indexes) {
+            if (!all_indexes.has(index)) {
+                all_indexes.push_back(index);
+            }
+        }
+        Dictionary statement;
+        statement["sql"] = sql;
+        statement["indexes"] = indexes;
+        statement["plan_before"] = explain_query_plan(db_ctx, sql);
+        const char* plan_after = sqlite3_expert_report(expert, i, EXPERT_REPORT_PLAN);
+        statement["plan_after"] = plan_after ? String::utf8(plan_after) : String();
+        statements.push_back(statement);
+    }
+    sqlite3_expert_destroy(expert);
+
+    Dictionary result;
+    result["indexes"] = all_indexes;
+    result["statements"] = statements;
+    return result;
+}
+
+bool SQLiteBinding::set_worker_threads(int count) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V(count < 0, false);
+    // Same as PRAGMA threads: helper threads for large sorts (ORDER BY,
+    // CREATE INDEX), capped by SQLITE_MAX_WORKER_THREADS.
+    sqlite3_limit(db_ctx, SQLITE_LIMIT_WORKER_THREADS, count);
+    const int applied = get_worker_threads();
+    ERR_FAIL_COND_V_MSG(applied != count, false, "Worker threads are limited to " + itos(applied));
     return true;
 }
 
-Array SQLiteBinding::query_fetch_rows(const String& query) {
-    return query_fetch_rows_with_args(query, Array());
+int SQLiteBinding::get_worker_threads() const {
+    ERR_FAIL_COND_V(db_ctx == nullptr, 0);
+    return sqlite3_limit(db_ctx, SQLITE_LIMIT_WORKER_THREADS, -1);
 }
 
-Array SQLiteBinding::query_fetch_rows_with_args(const String& query, const Array& arguments) {
+bool SQLiteBinding::set_temp_store(TempStore mode) {
+    ERR_FAIL_COND_V(mode < TEMP_STORE_DEFAULT || mode > TEMP_STORE_MEMORY, false);
+    return query("PRAGMA temp_store = " + itos(mode));
+}
+
+bool SQLiteBinding::set_cache_size(int kib) {
+    ERR_FAIL_COND_V(kib <= 0, false);
+    // The page cache size also bounds how much a sort keeps in memory
+    // before it spills sorted runs to temp storage.
+    return query("PRAGMA cache_size = -" + itos(kib));
+}
+
+sqlite3_stmt* SQLiteBinding::get_cached_statement(const String& query) {
+    HashMap<String, sqlite3_stmt*>::Iterator cached = statement_cache.find(query);
+    if (cached) {
+        sqlite3_reset(cached->value);
+        sqlite3_clear_bindings(cached->value);
+        return cached->value;
+    }
     sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
-    if (stmt == nullptr) {
-        return {};
+    if (stmt != nullptr) {
+        statement_cache.insert(query, stmt);
     }
-    if (!bind_args(stmt, arguments)) {
-        sqlite3_finalize(stmt);
-        return {};
+    return stmt;
+}
+
+void SQLiteBinding::clear_statement_cache() {
+    for (const KeyValue<String, sqlite3_stmt*>& E : statement_cache) {
+        sqlite3_finalize(E.value);
     }
-    Array array;
-    bool done = false;
-    while (!done) {
-        const int result = sqlite3_step(stmt);
-        switch (result) {
-        case SQLITE_ROW:
-            array.push_back(fetch_row(stmt));
-            break;
-        case SQLITE_DONE:
-            done = true;
-            break;
-        default:
-            print_error("Unsupported step result: " + itos(result));
-            return {};
-        }
+    statement_cache.clear();
+}
+
+// The authorizer and the trace read the listeners and the user authorizer
+// with the connection's mutex held, possibly on the thread of a memory
+// resident database, whose session prepares statements while persisting.
+// Changing them under the same mutex keeps those reads consistent.
+void SQLiteBinding::add_update_listener(SQLiteUpdateListener* listener) {
+    ERR_FAIL_NULL(listener);
+    sqlite3_mutex* mutex = db_ctx ? sqlite3_db_mutex(db_ctx) : nullptr;
+    sqlite3_mutex_enter(mutex);
+    const bool added = update_listeners.find(listener) < 0;
+    if (added) {
+        update_listeners.push_back(listener);
+    }
+    sqlite3_mutex_leave(mutex);
+    if (added) {
+        clear_statement_cache();
+    }
+}
+
+void SQLiteBinding::remove_update_listener(SQLiteUpdateListener* listener) {
+    sqlite3_mutex* mutex = db_ctx ? sqlite3_db_mutex(db_ctx) : nullptr;
+    sqlite3_mutex_enter(mutex);
+    update_listeners.erase(listener);
+    sqlite3_mutex_leave(mutex);
+}
+
+void SQLiteBinding::set_authorizer(Authorizer callback, void* user_data) {
+    sqlite3_mutex* mutex = db_ctx ? sqlite3_db_mutex(db_ctx) : nullptr;
+    sqlite3_mutex_enter(mutex);
+    user_authorizer = callback;
+    user_authorizer_data = user_data;
+    sqlite3_mutex_leave(mutex);
+    // Already compiled statements were authorized by the previous one.
+    clear_statement_cache();
+}
+
+bool SQLiteBinding::get_read_tables(const String& query, HashSet<String>& r_tables) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    // Held throughout, so statements prepared on other threads meanwhile do
+    // not add their tables.
+    sqlite3_mutex* mutex = sqlite3_db_mutex(db_ctx);
+    sqlite3_mutex_enter(mutex);
+    read_tables = &r_tables;
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    read_tables = nullptr;
+    sqlite3_mutex_leave(mutex);
+    if (stmt == nullptr) {
+        return false;
     }
     sqlite3_finalize(stmt);
-    return array;
+    return true;
+}
+
+bool SQLiteBinding::query(const String& query) {
+    return query_with_args(query, Array());
+}
+
+// Runs every statement in `script`, e.g. a schema or migration file.
+bool SQLiteBinding::execute_script(const String& script) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    char* error = nullptr;
+    if (sqlite3_exec(db_ctx, script.utf8().get_data(), nullptr, nullptr, &error) != SQLITE_OK) {
+        print_error("Failed to execute script: " + String::utf8(error ? error : ""));
+        sqlite3_free(error);
+        return false;
+    }
+    return true;
+}
+
+// Loads every row of `table` into a native map by `key_column`, so that
+// mirror_get() is a hash lookup instead of a query. Meant for small, hot
+// lookup tables; rows changed through this connection are read again on
+// the next mirror_get().
+bool SQLiteBinding::mirror_table(const String& table, const String& key_column) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    unmirror_table(table);
+    SQLiteTableMirror* mirror = memnew(SQLiteTableMirror(db_ctx, table, key_column));
+    if (!mirror->load()) {
+        memdelete(mirror);
+        return false;
+    }
+    mirrors.insert(table, mirror);
+    add_update_listener(mirror);
+    return true;
+}
+
+Dictionary SQLiteBinding::mirror_get(const String& table, const Variant& key) {
+    SQLiteTableMirror** mirror = mirrors.getptr(table);
+    ERR_FAIL_NULL_V_MSG(mirror, Dictionary(), "Table is not mirrored: " + table);
+    (*mirror)->sync();
+    const Dictionary* row = (*mirror)->get(key);
+    return row ? *row : Dictionary();
+}
+
+void SQLiteBinding::unmirror_table(const String& table) {
+    SQLiteTableMirror** mirror = mirrors.getptr(table);
+    if (mirror == nullptr) {
+        return;
+    }
+    remove_update_listener(*mirror);
+    memdelete(*mirror);
+    mirrors.erase(table);
+}
+
+void SQLiteBinding::_clear_mirrors() {
+    for (const KeyValue<String, SQLiteTableMirror*>& E : mirrors) {
+        remove_update_listener(E.value);
+        memdelete(E.value);
+    }
+    mirrors.clear();
+}
+
+// Starts recording row changes so that checkpoint() can number the current
+// state and rollback_to_checkpoint() can return to any of the last
+// `max_checkpoints` of them, e.g. for rollback netcode. 0 stops recording.
+bool SQLiteBinding::enable_checkpoints(int max_checkpoints) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    if (checkpoint_log != nullptr) {
+        memdelete(checkpoint_log);
+        checkpoint_log = nullptr;
+    }
+    if (max_checkpoints <= 0) {
+        return true;
+    }
+    checkpoint_log = memnew(SQLiteCheckpointLog(db_ctx, max_checkpoints));
+    if (!checkpoint_log->start()) {
+        memdelete(checkpoint_log);
+        checkpoint_log = nullptr;
+        return false;
+    }
+    return true;
+}
+
+int64_t SQLiteBinding::checkpoint() {
+    ERR_FAIL_NULL_V_MSG(checkpoint_log, -1, "Checkpoints are not enabled");
+    return checkpoint_log->checkpoint();
+}
+
+bool SQLiteBinding::rollback_to_checkpoint(int64_t id) {
+    ERR_FAIL_NULL_V_MSG(checkpoint_log, false, "Checkpoints are not enabled");
+    return checkpoint_log->rollback_to(id);
+}
+
+int64_t SQLiteBinding::get_oldest_checkpoint() const {
+    return checkpoint_log ? checkpoint_log->get_oldest() : -1;
+}
+
+int64_t SQLiteBinding::get_latest_checkpoint() const {
+    return checkpoint_log ? checkpoint_log->get_latest() : -1;
+}
+
+// Returns the database version this connection reads. Outside a transaction
+// a read transaction is started for it and ended again before returning, so
+// a checkpoint may discard that version before another connection opens it,
+// in which case snapshot_open() fails. Open it right away, or take it inside
+// a transaction of your own, which keeps the version until you end it. The
+// database must be in WAL mode.
+Ref<SQLiteSnapshot> SQLiteBinding::snapshot_get() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, Ref<SQLiteSnapshot>());
+    const bool begin = sqlite3_get_autocommit(db_ctx);
+    if (begin) {
+        ERR_FAIL_COND_V(!query("BEGIN"), Ref<SQLiteSnapshot>());
+    }
+    sqlite3_snapshot* handle = nullptr;
+    if (sqlite3_snapshot_get(db_ctx, "main", &handle) != SQLITE_OK) {
+        print_error("Failed to get snapshot (is the database in WAL mode?): " + String::utf8(sqlite3_errmsg(db_ctx)));
+        if (begin) {
+            query("ROLLBACK");
+        }
+        return Ref<SQLiteSnapshot>();
+    }
+    if (begin && sqlite3_exec(db_ctx, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        print_error("Failed to end snapshot transaction: " + String::utf8(sqlite3_errmsg(db_ctx)));
+    }
+    Ref<SQLiteSnapshot> snapshot;
+    snapshot.instantiate();
+    snapshot->set_handle(handle);
+    return snapshot;
+}
+
+// Starts a read transaction on this connection at `snapshot`. Queries see
+// that version until snapshot_close(), which must be called before this
+// connection can see newer changes or write.
+bool SQLiteBinding::snapshot_open(const Ref<SQLiteSnapshot>& snapshot) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V(snapshot.is_null() || snapshot->get_handle() == nullptr, false);
+    ERR_FAIL_COND_V_MSG(!sqlite3_get_autocommit(db_ctx), false, "A transaction is already open");
+    // The read opens the WAL on a connection that has not read anything yet;
+    // sqlite3_snapshot_open() then moves the transaction to the snapshot.
+    if (sqlite3_exec(db_ctx, "BEGIN; SELECT 1 FROM sqlite_schema LIMIT 1", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        print_error("Failed to open snapshot: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        if (!sqlite3_get_autocommit(db_ctx)) {
+            query("ROLLBACK");
+        }
+        return false;
+    }
+    if (sqlite3_snapshot_open(db_ctx, "main", snapshot->get_handle()) != SQLITE_OK) {
+        print_error("Failed to open snapshot: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        query("ROLLBACK");
+        return false;
+    }
+    reading_snapshot = true;
+    return true;
+}
+
+// Ends the read transaction started by snapshot_open().
+bool SQLiteBinding::snapshot_close() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V_MSG(!reading_snapshot, false, "No snapshot is open");
+    reading_snapshot = false;
+    if (sqlite3_get_autocommit(db_ctx)) {
+        // Already ended with query("END").
+        return true;
+    }
+    if (sqlite3_exec(db_ctx, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        print_error("Failed to close snapshot: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        return false;
+    }
+    return true;
+}
+
+void SQLiteBinding::set_query_library(const Ref<SQLQueryLibrary>& library) {
+    query_library = library;
+}
+
+// Prepares every query of the library into the statement cache. Returns
+// false, after reporting each broken query, if any of them fails.
+bool SQLiteBinding::prepare_library() {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V(query_library.is_null(), false);
+    bool ok = true;
+    const PackedStringArray names = query_library->get_query_names();
+    for (const String& name : names) {
+        const String sql = query_library->get_query(name);
+        if (statement_cache.has(sql)) {
+            continue;
+        }
+        const CharString utf8 = sql.utf8();
+        sqlite3_stmt* stmt = nullptr;
+        const char* tail = nullptr;
+        if (sqlite3_prepare_v2(db_ctx, utf8.get_data(), utf8.length(), &stmt, &tail) != SQLITE_OK) {
+            print_error("Query " + name + ": " + String::utf8(sqlite3_errmsg(db_ctx)));
+            ok = false;
+            continue;
+        }
+        if (!String::utf8(tail).strip_edges().is_empty()) {
+            print_error("Query " + name + ": only one statement per query is supported");
+            sqlite3_finalize(stmt);
+            ok = false;
+            continue;
+        }
+        statement_cache.insert(sql, stmt);
+    }
+    return ok;
+}
+
+Array SQLiteBinding::run(const String& name, const Array& arguments) {
+    ERR_FAIL_COND_V_MSG(query_library.is_null(), Array(), "No query library is set");
+    ERR_FAIL_COND_V_MSG(!query_library->has_query(name), Array(), "Unknown query: " + name);
+    sqlite3_stmt* stmt = get_cached_statement(query_library->get_query(name));
+    if (stmt == nullptr) {
+        return Array();
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_reset(stmt);
+        return Array();
+    }
+    RowDecoder decoder(stmt);
+    Array array;
+    int result = SQLITE_ROW;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        array.push_back(decoder.fetch_row(stmt));
+    }
+    sqlite3_reset(stmt);
+    ERR_FAIL_COND_V_MSG(result != SQLITE_DONE, Array(), "Query " + name + ": " + String::utf8(sqlite3_errmsg(db_ctx)));
+    return array;
+}
+
+bool SQLiteBinding::query_with_args(const String& query, const Array& arguments) {
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return false;
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    // Only the first row is stepped to; statements that return rows, such
+    // as some PRAGMAs, still count as run.
+    const int result = sqlite3_step(stmt);
+    if (result != SQLITE_ROW && result != SQLITE_DONE) {
+        print_error("Failed to execute query: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+Array SQLiteBinding::query_fetch_rows(const String& query) {
+    return query_fetch_rows_with_args(query, Array());
+}
+
+Array SQLiteBinding::query_fetch_rows_with_args(const String& query, const Array& arguments) {
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return {};
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return {};
+    }
+    RowDecoder decoder(stmt);
+    Array array;
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+            array.push_back(decoder.fetch_row(stmt));
+            break;
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return {};
+        }
+    }
+    sqlite3_finalize(stmt);
+    return array;
+}
+
+// Like query_fetch_rows_with_args(), but values stay undecoded until read.
+Ref<SQLiteRowSet> SQLiteBinding::query_fetch_row_set(const String& query, const Array& arguments) {
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return Ref<SQLiteRowSet>();
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return Ref<SQLiteRowSet>();
+    }
+    Ref<SQLiteRowSet> rows;
+    rows.instantiate();
+    rows->set_columns(stmt);
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+            rows->append_row(stmt);
+            break;
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return Ref<SQLiteRowSet>();
+        }
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+namespace {
+
+// How one result column is written into the hydrated objects. Resolved once
+// per statement so rows only pay for the value conversion and the call.
+struct ColumnTarget {
+    StringName property;
+    MethodBind* setter = nullptr;
+};
+
+}
+
+Array SQLiteBinding::query_fetch_objects(const String& query, const Array& arguments,
+        const Variant& class_name_or_script) {
+    StringName class_name;
+    Ref<Script> script;
+    if (class_name_or_script.get_type() == Variant::STRING || class_name_or_script.get_type() == Variant::STRING_NAME) {
+        class_name = class_name_or_script;
+    } else {
+        script = class_name_or_script;
+        ERR_FAIL_COND_V_MSG(script.is_null(), {}, "Expected a class name or a Script.");
+        ERR_FAIL_COND_V_MSG(!script->can_instantiate(), {}, "Script cannot be instantiated.");
+        class_name = script->get_instance_base_type();
+    }
+    ERR_FAIL_COND_V_MSG(!ClassDB::can_instantiate(class_name), {}, "Cannot instantiate class: " + class_name);
+
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return {};
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return {};
+    }
+
+    HashSet<StringName> script_properties;
+    if (script.is_valid()) {
+        List<PropertyInfo> properties;
+        script->get_script_property_list(&properties);
+        for (const PropertyInfo& info : properties) {
+            script_properties.insert(info.name);
+        }
+    }
+
+    const int column_count = sqlite3_column_count(stmt);
+    LocalVector<ColumnTarget> targets;
+    targets.resize(column_count);
+    for (int i = 0; i < column_count; ++i) {
+        ColumnTarget& target = targets[i];
+        target.property = StringName(String::utf8(sqlite3_column_name(stmt, i)));
+        // Script properties, indexed properties and properties without a
+        // bound setter go through Object::set.
+        if (script_properties.has(target.property) || ClassDB::get_property_index(class_name, target.property) != -1) {
+            continue;
+        }
+        const StringName setter = ClassDB::get_property_setter(class_name, target.property);
+        if (setter != StringName()) {
+            target.setter = ClassDB::get_method(class_name, setter);
+        }
+    }
+
+    Array objects;
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+        {
+            Object* object = ClassDB::instantiate(class_name);
+            if (object == nullptr) {
+                sqlite3_finalize(stmt);
+                ERR_FAIL_V_MSG({}, "Failed to instantiate " + class_name);
+            }
+            // Keep RefCounted instances alive while they are being filled.
+            const Variant holder = object;
+            if (script.is_valid()) {
+                object->set_script(script);
+                // A script _set() sees every property before ClassDB does,
+                // which calling the cached setters directly would skip.
+                if (objects.is_empty() && object->get_script_instance() != nullptr &&
+                        object->get_script_instance()->has_method(SNAME("_set"))) {
+                    for (ColumnTarget& target : targets) {
+                        target.setter = nullptr;
+                    }
+                }
+            }
+            bool filled = true;
+            for (int i = 0; filled && i < column_count; ++i) {
+                if (sqlite3_column_type(stmt, i) == SQLITE_NULL) {
+                    continue;
+                }
+                const Variant value = column_value(stmt, i);
+                const ColumnTarget& target = targets[i];
+                if (target.setter != nullptr) {
+                    const Variant* args[1] = { &value };
+                    Callable::CallError error;
+                    target.setter->call(object, args, 1, error);
+                    if (error.error != Callable::CallError::CALL_OK) {
+                        print_error("Failed to set " + String(target.property) + ": " +
+                            Variant::get_call_error_text(object, target.setter->get_name(), args, 1, error));
+                        filled = false;
+                    }
+                } else {
+                    bool valid = false;
+                    object->set(target.property, value, &valid);
+                    if (!valid) {
+                        print_error("Failed to set " + String(target.property) + " from a " + Variant::get_type_name(value.get_type()));
+                        filled = false;
+                    }
+                }
+            }
+            if (!filled) {
+                // A half-filled object would pass for a good row.
+                sqlite3_finalize(stmt);
+                return {};
+            }
+            objects.push_back(holder);
+            break;
+        }
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return {};
+        }
+    }
+    sqlite3_finalize(stmt);
+    return objects;
+}
+
+// Fills an interleaved float buffer, one `layout.size()` stride per row.
+// Layout entries are column names, column indices or float constants, e.g.
+// a MultiMesh instance with a Transform3D and a Color is
+//     ["bx_x", "by_x", "bz_x", "x", "bx_y", "by_y", "bz_y", "y",
+//      "bx_z", "by_z", "bz_z", "z", "r", "g", "b", 1.0]
+// which can go straight to RenderingServer.multimesh_set_buffer().
+PackedFloat32Array SQLiteBinding::query_into_float_buffer(const String& query, const Array& arguments,
+        const Array& layout) {
+    ERR_FAIL_COND_V(layout.is_empty(), PackedFloat32Array());
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return PackedFloat32Array();
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return PackedFloat32Array();
+    }
+
+    struct Slot {
+        int column = -1;
+        float constant = 0.0f;
+    };
+    const int column_count = sqlite3_column_count(stmt);
+    const int stride = layout.size();
+    LocalVector<Slot> slots;
+    slots.resize(stride);
+    for (int i = 0; i < stride; ++i) {
+        const Variant& entry = layout[i];
+        switch (entry.get_type()) {
+        case Variant::STRING:
+        case Variant::STRING_NAME:
+        {
+            const CharString name = String(entry).utf8();
+            for (int c = 0; c < column_count; ++c) {
+                if (strcmp(sqlite3_column_name(stmt, c), name.get_data()) == 0) {
+                    slots[i].column = c;
+                    break;
+                }
+            }
+            if (slots[i].column < 0) {
+                sqlite3_finalize(stmt);
+                ERR_FAIL_V_MSG(PackedFloat32Array(), "Layout refers to an unknown column: " + String(entry));
+            }
+            break;
+        }
+        case Variant::INT:
+            if (int(entry) < 0 || int(entry) >= column_count) {
+                sqlite3_finalize(stmt);
+                ERR_FAIL_V_MSG(PackedFloat32Array(), "Layout column index out of range: " + itos(entry));
+            }
+            slots[i].column = entry;
+            break;
+        case Variant::FLOAT:
+            slots[i].constant = entry;
+            break;
+        default:
+            sqlite3_finalize(stmt);
+            ERR_FAIL_V_MSG(PackedFloat32Array(), "Unsupported layout entry type: " + itos(entry.get_type()));
+        }
+    }
+
+    PackedFloat32Array buffer;
+    int64_t rows = 0;
+    int64_t capacity = 0;
+    float* write = nullptr;
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+        {
+            if (rows == capacity) {
+                capacity = MAX(capacity * 2, 256);
+                buffer.resize(capacity * stride);
+                write = buffer.ptrw();
+            }
+            float* out = write + rows * stride;
+            for (const Slot& slot : slots) {
+                // NULL reads as 0.0.
+                *out++ = slot.column < 0 ? slot.constant : static_cast<float>(sqlite3_column_double(stmt, slot.column));
+            }
+            ++rows;
+            break;
+        }
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return PackedFloat32Array();
+        }
+    }
+    sqlite3_finalize(stmt);
+    buffer.resize(rows * stride);
+    return buffer;
+}
+
+namespace {
+
+// Distinct UTF-8 values of one text column, found by their bytes with a
+// small open addressing table while stepping, so a value repeated on many
+// rows becomes a String only once.
+class StringDictionary {
+    struct Entry {
+        uint32_t hash;
+        uint32_t offset;
+        uint32_t length;
+    };
+    LocalVector<Entry> entries;
+    LocalVector<char> bytes;
+    // Code + 1 of the entry in each slot, 0 for a free slot.
+    LocalVector<int32_t> slots;
+
+    void _rehash(uint32_t capacity) {
+        slots.resize(capacity);
+        memset(slots.ptr(), 0, capacity * sizeof(int32_t));
+        const uint32_t mask = capacity - 1;
+        for (uint32_t code = 0; code < entries.size(); ++code) {
+            uint32_t slot = entries[code].hash & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = code + 1;
+        }
+    }
+
+public:
+    PackedStringArray values;
+
+    int32_t find_or_add(const char* text, uint32_t length) {
+        if (slots.is_empty()) {
+            _rehash(64);
+        }
+        const uint32_t hash = hash_murmur3_buffer(text, length);
+        const uint32_t mask = slots.size() - 1;
+        uint32_t slot = hash & mask;
+        while (slots[slot] != 0) {
+            const int32_t code = slots[slot] - 1;
+            const Entry& entry = entries[code];
+            if (entry.hash == hash && entry.length == length && memcmp(bytes.ptr() + entry.offset, text, length) == 0) {
+                return code;
+            }
+            slot = (slot + 1) & mask;
+        }
+        const int32_t code = entries.size();
+        entries.push_back({ hash, bytes.size(), length });
+        bytes.resize(bytes.size() + length);
+        if (length > 0) {
+            memcpy(bytes.ptr() + entries[code].offset, text, length);
+        }
+        values.push_back(decode_utf8(text, length));
+        slots[slot] = code + 1;
+        if (entries.size() * 2 > slots.size()) {
+            _rehash(slots.size() * 2);
+        }
+        return code;
+    }
+};
+
+template <typename T, typename Packed>
+Packed to_packed(const LocalVector<T>& values) {
+    Packed result;
+    result.resize(values.size());
+    if (!values.is_empty()) {
+        memcpy(result.ptrw(), values.ptr(), values.size() * sizeof(T));
+    }
+    return result;
+}
+
+// One column of query_fetch_columns() output. Numbers and strings go into
+// plain vectors that are copied into a packed array once at the end.
+struct ColumnSink {
+    enum Kind {
+        KIND_INT,
+        KIND_FLOAT,
+        KIND_TEXT,
+        KIND_DICTIONARY,
+        KIND_VARIANT,
+    };
+    Kind kind = KIND_VARIANT;
+    LocalVector<int64_t> ints;
+    LocalVector<double> floats;
+    PackedStringArray strings;
+    StringDictionary dictionary;
+    LocalVector<int32_t> codes;
+    Array values;
+    // Rows read so far and the ones that were NULL, so that a column falling
+    // back to Variants still reports those as null.
+    uint32_t rows = 0;
+    LocalVector<uint32_t> nulls;
+
+    bool _accepts(int type) const {
+        switch (kind) {
+        case KIND_INT:
+            return type == SQLITE_INTEGER;
+        case KIND_FLOAT:
+            return type == SQLITE_FLOAT || type == SQLITE_INTEGER;
+        case KIND_TEXT:
+        case KIND_DICTIONARY:
+            return type == SQLITE_TEXT;
+        default:
+            return true;
+        }
+    }
+
+    // Moves what was read so far into `values`, e.g. when a TEXT cell shows
+    // up in an INTEGER column, which would otherwise read as 0.
+    void _fall_back() {
+        values.resize(rows);
+        for (uint32_t i = 0; i < rows; ++i) {
+            switch (kind) {
+            case KIND_INT:
+                values[i] = ints[i];
+                break;
+            case KIND_FLOAT:
+                values[i] = floats[i];
+                break;
+            case KIND_TEXT:
+                values[i] = strings[i];
+                break;
+            default:
+                values[i] = codes[i] < 0 ? Variant() : Variant(dictionary.values[codes[i]]);
+                break;
+            }
+        }
+        for (uint32_t row : nulls) {
+            values[row] = Variant();
+        }
+        ints.clear();
+        floats.clear();
+        strings.clear();
+        codes.clear();
+        nulls.clear();
+        kind = KIND_VARIANT;
+    }
+
+    void append(sqlite3_stmt* stmt, int column) {
+        if (kind != KIND_VARIANT) {
+            const int type = sqlite3_column_type(stmt, column);
+            if (type == SQLITE_NULL) {
+                nulls.push_back(rows);
+            } else if (!_accepts(type)) {
+                _fall_back();
+            }
+        }
+        ++rows;
+        switch (kind) {
+        case KIND_INT:
+            ints.push_back(sqlite3_column_int64(stmt, column));
+            break;
+        case KIND_FLOAT:
+            floats.push_back(sqlite3_column_double(stmt, column));
+            break;
+        case KIND_TEXT:
+        {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+            strings.push_back(decode_utf8(text, sqlite3_column_bytes(stmt, column)));
+            break;
+        }
+        case KIND_DICTIONARY:
+        {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+            codes.push_back(text == nullptr ? -1 : dictionary.find_or_add(text, sqlite3_column_bytes(stmt, column)));
+            break;
+        }
+        default:
+            values.push_back(column_value(stmt, column));
+            break;
+        }
+    }
+
+    Variant finish() const {
+        switch (kind) {
+        case KIND_INT:
+            return to_packed<int64_t, PackedInt64Array>(ints);
+        case KIND_FLOAT:
+            return to_packed<double, PackedFloat64Array>(floats);
+        case KIND_TEXT:
+            return strings;
+        case KIND_DICTIONARY:
+        {
+            Dictionary result;
+            result["values"] = dictionary.values;
+            result["codes"] = to_packed<int32_t, PackedInt32Array>(codes);
+            return result;
+        }
+        default:
+            return values;
+        }
+    }
+};
+
+}
+
+// Returns a Dictionary of column name -> one array of every row's values:
+// PackedInt64Array, PackedFloat64Array or PackedStringArray by declared
+// column type (NULL reads as 0 or ""), and an Array of Variants for other
+// columns and for typed columns holding a value of another type. Text columns listed in `dictionary_columns` come back as
+// {"values": PackedStringArray of distinct values, "codes": PackedInt32Array
+// of indices into it, -1 for NULL}, which insert_columns() accepts as well.
+Dictionary SQLiteBinding::query_fetch_columns(const String& query, const Array& arguments,
+        const PackedStringArray& dictionary_columns) {
+    sqlite3_stmt* stmt = prepare(db_ctx, query.utf8().get_data());
+    if (stmt == nullptr) {
+        return Dictionary();
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return Dictionary();
+    }
+    const int column_count = sqlite3_column_count(stmt);
+    LocalVector<ColumnSink> sinks;
+    sinks.resize(column_count);
+    for (int i = 0; i < column_count; ++i) {
+        const String name = String::utf8(sqlite3_column_name(stmt, i));
+        switch (get_declared_type(sqlite3_column_decltype(stmt, i))) {
+        case SQLITE_INTEGER:
+            sinks[i].kind = ColumnSink::KIND_INT;
+            break;
+        case SQLITE_FLOAT:
+            sinks[i].kind = ColumnSink::KIND_FLOAT;
+            break;
+        case SQLITE_TEXT:
+            sinks[i].kind = dictionary_columns.has(name) ? ColumnSink::KIND_DICTIONARY : ColumnSink::KIND_TEXT;
+            break;
+        default:
+            // Untyped text (e.g. an expression) can still be encoded.
+            if (dictionary_columns.has(name)) {
+                sinks[i].kind = ColumnSink::KIND_DICTIONARY;
+            }
+            break;
+        }
+    }
+
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+            for (int i = 0; i < column_count; ++i) {
+                sinks[i].append(stmt, i);
+            }
+            break;
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return Dictionary();
+        }
+    }
+    Dictionary columns;
+    for (int i = 0; i < column_count; ++i) {
+        columns[String::utf8(sqlite3_column_name(stmt, i))] = sinks[i].finish();
+    }
+    sqlite3_finalize(stmt);
+    return columns;
+}
+
+namespace {
+
+// One column of insert_columns() input, bound by row index without
+// creating a Variant per value.
+struct ColumnSource {
+    Variant::Type type = Variant::NIL;
+    PackedInt32Array ints32;
+    PackedInt64Array ints64;
+    PackedFloat32Array floats32;
+    PackedFloat64Array floats64;
+    PackedStringArray strings;
+    Array values;
+    // A dictionary encoded column: each distinct value converted once.
+    LocalVector<CharString> texts;
+    PackedInt32Array codes;
+
+    bool set(const Variant& data, int& r_size) {
+        type = data.get_type();
+        switch (type) {
+        case Variant::DICTIONARY:
+        {
+            const Dictionary encoded = data;
+            if (encoded.get("values", Variant()).get_type() != Variant::PACKED_STRING_ARRAY ||
+                    encoded.get("codes", Variant()).get_type() != Variant::PACKED_INT32_ARRAY) {
+                return false;
+            }
+            strings = encoded["values"];
+            codes = encoded["codes"];
+            for (const int32_t code : codes) {
+                if (code < -1 || code >= strings.size()) {
+                    return false;
+                }
+            }
+            texts.resize(strings.size());
+            for (int i = 0; i < strings.size(); ++i) {
+                texts[i] = strings[i].utf8();
+            }
+            r_size = codes.size();
+            return true;
+        }
+        case Variant::PACKED_INT32_ARRAY:
+            ints32 = data;
+            r_size = ints32.size();
+            return true;
+        case Variant::PACKED_INT64_ARRAY:
+            ints64 = data;
+            r_size = ints64.size();
+            return true;
+        case Variant::PACKED_FLOAT32_ARRAY:
+            floats32 = data;
+            r_size = floats32.size();
+            return true;
+        case Variant::PACKED_FLOAT64_ARRAY:
+            floats64 = data;
+            r_size = floats64.size();
+            return true;
+        case Variant::PACKED_STRING_ARRAY:
+            strings = data;
+            r_size = strings.size();
+            return true;
+        case Variant::ARRAY:
+            values = data;
+            r_size = values.size();
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool bind(sqlite3_stmt* stmt, int index, int row) const {
+        switch (type) {
+        case Variant::PACKED_INT32_ARRAY:
+            return sqlite3_bind_int(stmt, index, ints32[row]) == SQLITE_OK;
+        case Variant::PACKED_INT64_ARRAY:
+            return sqlite3_bind_int64(stmt, index, ints64[row]) == SQLITE_OK;
+        case Variant::PACKED_FLOAT32_ARRAY:
+            return sqlite3_bind_double(stmt, index, floats32[row]) == SQLITE_OK;
+        case Variant::PACKED_FLOAT64_ARRAY:
+            return sqlite3_bind_double(stmt, index, floats64[row]) == SQLITE_OK;
+        case Variant::PACKED_STRING_ARRAY:
+        {
+            const CharString text = strings[row].utf8();
+            return sqlite3_bind_text(stmt, index, text.get_data(), text.length(), SQLITE_TRANSIENT) == SQLITE_OK;
+        }
+        case Variant::DICTIONARY:
+        {
+            if (codes[row] < 0) {
+                return sqlite3_bind_null(stmt, index) == SQLITE_OK;
+            }
+            const CharString& text = texts[codes[row]];
+            return sqlite3_bind_text(stmt, index, text.get_data(), text.length(), SQLITE_STATIC) == SQLITE_OK;
+        }
+        default:
+            return bind_value(stmt, index, values[row]);
+        }
+    }
+
+    bool less(int a, int b) const {
+        switch (type) {
+        case Variant::PACKED_INT32_ARRAY:
+            return ints32[a] < ints32[b];
+        case Variant::PACKED_INT64_ARRAY:
+            return ints64[a] < ints64[b];
+        case Variant::PACKED_FLOAT32_ARRAY:
+            return floats32[a] < floats32[b];
+        case Variant::PACKED_FLOAT64_ARRAY:
+            return floats64[a] < floats64[b];
+        case Variant::PACKED_STRING_ARRAY:
+            return strings[a] < strings[b];
+        case Variant::DICTIONARY:
+            // NULL first, as in SQLite.
+            return codes[a] < 0 ? codes[b] >= 0 : codes[b] >= 0 && strings[codes[a]] < strings[codes[b]];
+        default:
+            return values[a] < values[b];
+        }
+    }
+};
+
+struct RowOrder {
+    const ColumnSource* key = nullptr;
+
+    bool operator()(int a, int b) const {
+        return key->less(a, b);
+    }
+};
+
+}
+
+// Inserts one row per array index from a Dictionary of column name ->
+// PackedInt32/Int64/Float32/Float64/StringArray, Array or a dictionary
+// encoded column as returned by query_fetch_columns(), using one
+// cached statement inside a savepoint. Rows can be sorted by a column
+// first, so rows land in B-tree order when it is the primary key.
+bool SQLiteBinding::insert_columns(const String& table, const Dictionary& columns, const String& sort_by_column) {
+    ERR_FAIL_COND_V(db_ctx == nullptr, false);
+    ERR_FAIL_COND_V(columns.is_empty(), false);
+
+    const Array names = columns.keys();
+    LocalVector<ColumnSource> sources;
+    sources.resize(names.size());
+    int row_count = -1;
+    int sort_column = -1;
+    String column_list;
+    String placeholders;
+    for (int i = 0; i < names.size(); ++i) {
+        const String name = names[i];
+        int size = 0;
+        ERR_FAIL_COND_V_MSG(!sources[i].set(columns[names[i]], size), false, "Unsupported column data for " + name);
+        ERR_FAIL_COND_V_MSG(row_count >= 0 && size != row_count, false, "Column " + name + " has a different length");
+        row_count = size;
+        if (name == sort_by_column) {
+            sort_column = i;
+        }
+        column_list += (i > 0 ? ", " : "") + quote_identifier(name);
+        placeholders += i > 0 ? ", ?" : "?";
+    }
+    ERR_FAIL_COND_V_MSG(!sort_by_column.is_empty() && sort_column < 0, false, "Unknown sort column: " + sort_by_column);
+
+    LocalVector<int> order;
+    order.resize(row_count);
+    for (int r = 0; r < row_count; ++r) {
+        order[r] = r;
+    }
+    if (sort_column >= 0) {
+        SortArray<int, RowOrder> sorter;
+        sorter.compare.key = &sources[sort_column];
+        sorter.sort(order.ptr(), order.size());
+    }
+
+    sqlite3_stmt* stmt = get_cached_statement("INSERT INTO " + quote_identifier(table) + " (" + column_list +
+        ") VALUES (" + placeholders + ")");
+    if (stmt == nullptr) {
+        return false;
+    }
+    if (sqlite3_exec(db_ctx, "SAVEPOINT insert_columns", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        print_error("Failed to start transaction: " + String::utf8(sqlite3_errmsg(db_ctx)));
+        return false;
+    }
+    bool ok = true;
+    for (int r = 0; ok && r < row_count; ++r) {
+        for (uint32_t c = 0; ok && c < sources.size(); ++c) {
+            ok = sources[c].bind(stmt, c + 1, order[r]);
+        }
+        if (ok && sqlite3_step(stmt) != SQLITE_DONE) {
+            print_error("Failed to insert row " + itos(order[r]) + ": " + String::utf8(sqlite3_errmsg(db_ctx)));
+            ok = false;
+        }
+        sqlite3_reset(stmt);
+    }
+    // Dictionary encoded text is bound without a copy; the cached statement
+    // must not keep pointers into `sources`.
+    sqlite3_clear_bindings(stmt);
+    if (!ok) {
+        sqlite3_exec(db_ctx, "ROLLBACK TO insert_columns; RELEASE insert_columns", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return sqlite3_exec(db_ctx, "RELEASE insert_columns", nullptr, nullptr, nullptr) == SQLITE_OK;
 }
@@ -22,14 +22,102 @@
 
 #pragma once
 
+#include "sql_query_library.h"
+#include "sqlite_row_set.h"
+#include "sqlite_snapshot.h"
+
+#include "core/io/file_access.h"
 #include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
 
 struct sqlite3;
+struct sqlite3_stmt;
+class SQLiteCheckpointLog;
+class SQLiteTableMirror;
+class SQLiteWriteThrough;
+
+// Receives row changes made through a connection (see sqlite3_update_hook).
+// Listeners must not run SQL on the connection from inside the callback.
+// watches_table() is called whenever a statement is compiled, which may be
+// on another thread with the connection's mutex held.
+class SQLiteUpdateListener {
+public:
+    virtual ~SQLiteUpdateListener() = default;
+    virtual void on_row_updated(int operation, const char* table, int64_t rowid) = 0;
+    // Whether this listener needs the changes to `table`. While a table is
+    // watched, statements delete its rows one at a time, so that DELETE
+    // without WHERE reports them too instead of truncating the table.
+    virtual bool watches_table(const char* table) const { return true; }
+    // The open transaction was rolled back, undoing the changes reported
+    // since it began, or ROLLBACK TO is about to undo those reported since
+    // a savepoint.
+    virtual void on_rollback() {}
+};
 
 class SQLiteBinding : public RefCounted {
     GDCLASS(SQLiteBinding, RefCounted);
 
+public:
+    // See sqlite3_set_authorizer().
+    typedef int (*Authorizer)(void* user_data, int action, const char* arg1, const char* arg2, const char* database,
+            const char* trigger);
+
+    enum TempStore {
+        TEMP_STORE_DEFAULT = 0,
+        TEMP_STORE_FILE = 1,
+        TEMP_STORE_MEMORY = 2,
+    };
+
+private:
     sqlite3* db_ctx = nullptr;
+    LocalVector<SQLiteUpdateListener*> update_listeners;
+    Authorizer user_authorizer = nullptr;
+    void* user_authorizer_data = nullptr;
+    HashSet<String>* read_tables = nullptr;
+    HashMap<String, sqlite3_stmt*> statement_cache;
+    String db_path;
+    Ref<SQLQueryLibrary> query_library;
+    SQLiteWriteThrough* write_through = nullptr;
+    SQLiteCheckpointLog* checkpoint_log = nullptr;
+    HashMap<String, SQLiteTableMirror*> mirrors;
+    // Set by snapshot_open() until snapshot_close().
+    bool reading_snapshot = false;
+
+    int blob_compression_mode = -1;
+    int blob_compression_threshold = 256;
+
+    bool optimize_on_close = false;
+    int analysis_limit = 400;
+    int optimize_interval_msec = 0;
+    uint64_t last_optimize_usec = 0;
+    WorkerThreadPool::TaskID optimize_task = WorkerThreadPool::INVALID_TASK_ID;
+
+    struct OpenTask;
+    OpenTask* open_task = nullptr;
+    WorkerThreadPool::TaskID open_task_id = WorkerThreadPool::INVALID_TASK_ID;
+
+    static void _open_task(void* user_data);
+    void _finish_open_async();
+    void _attach(sqlite3* db, const String& real_path);
+
+    static void _optimize_task(void* user_data);
+    static bool _run_optimize(sqlite3* db, int limit);
+    bool optimize_queued = false;
+    void _on_idle();
+    void _update_idle_hook();
+    void _optimize_deferred();
+    void _wait_for_optimize();
+
+    static void _update_hook(void* user_data, int operation, const char* database, const char* table,
+            long long rowid);
+    static void _rollback_hook(void* user_data);
+    static int _trace(unsigned int type, void* user_data, void* stmt, void* sql);
+    static int _authorize(void* user_data, int action, const char* arg1, const char* arg2, const char* database,
+            const char* trigger);
+    void _clear_mirrors();
 
 protected:
     static void _bind_methods();
@@ -39,10 +127,89 @@ public:
     ~SQLiteBinding();
 
     bool open(const String& path);
+    bool open_overlay(const String& base_path, const String& delta_path);
+    bool open_memory_resident(const String& path, int persist_interval_msec = 1000);
+    bool persist();
+    bool open_compressed(const String& path, bool read_only = false, int compression_mode = FileAccess::COMPRESSION_ZSTD);
+    bool save_compressed(const String& path, int compression_mode = FileAccess::COMPRESSION_ZSTD);
+    bool open_async(const String& path, const Dictionary& options = Dictionary());
+    bool is_opening() const { return open_task != nullptr; }
     bool close();
 
     bool query(const String& query);
+    bool execute_script(const String& script);
     bool query_with_args(const String& query, const Array& arguments);
     Array query_fetch_rows(const String& query);
     Array query_fetch_rows_with_args(const String& query, const Array& arguments);
+    Ref<SQLiteRowSet> query_fetch_row_set(const String& query, const Array& arguments = Array());
+    Array query_fetch_objects(const String& query, const Array& arguments, const Variant& class_name_or_script);
+    PackedFloat32Array query_into_float_buffer(const String& query, const Array& arguments, const Array& layout);
+    Dictionary query_fetch_columns(const String& query, const Array& arguments = Array(),
+        const PackedStringArray& dictionary_columns = PackedStringArray());
+    bool insert_columns(const String& table, const Dictionary& columns, const String& sort_by_column = String());
+
+    bool mirror_table(const String& table, const String& key_column);
+    Dictionary mirror_get(const String& table, const Variant& key);
+    void unmirror_table(const String& table);
+
+    bool enable_checkpoints(int max_checkpoints);
+    int64_t checkpoint();
+    bool rollback_to_checkpoint(int64_t id);
+    int64_t get_oldest_checkpoint() const;
+    int64_t get_latest_checkpoint() const;
+
+    Ref<SQLiteSnapshot> snapshot_get();
+    bool snapshot_open(const Ref<SQLiteSnapshot>& snapshot);
+    bool snapshot_close();
+
+    void set_query_library(const Ref<SQLQueryLibrary>& library);
+    Ref<SQLQueryLibrary> get_query_library() const { return query_library; }
+    bool prepare_library();
+    Array run(const String& name, const Array& arguments = Array());
+
+    Dictionary recommend_indexes(const PackedStringArray& queries);
+
+    bool optimize();
+    bool optimize_async();
+    // FileAccess::CompressionMode used for blob arguments, or -1 for none.
+    void set_blob_compression_mode(int mode);
+    int get_blob_compression_mode() const { return blob_compression_mode; }
+    void set_blob_compression_threshold(int bytes);
+    int get_blob_compression_threshold() const { return blob_compression_threshold; }
+
+    void set_optimize_on_close(bool enabled) { optimize_on_close = enabled; }
+    bool get_optimize_on_close() const { return optimize_on_close; }
+    // Checked once per frame; requires a SceneTree main loop. Set it from the
+    // main thread.
+    void set_optimize_interval(int msec);
+    int get_optimize_interval() const { return optimize_interval_msec; }
+    void set_analysis_limit(int limit) { analysis_limit = limit; }
+    int get_analysis_limit() const { return analysis_limit; }
+
+    Dictionary export_planner_stats();
+    bool load_planner_stats(const Dictionary& stats);
+
+    bool set_worker_threads(int count);
+    int get_worker_threads() const;
+    bool set_temp_store(TempStore mode);
+    bool set_cache_size(int kib);
+
+    sqlite3* get_handle() const { return db_ctx; }
+    // Returns a statement prepared once per connection, reset and with its
+    // bindings cleared. Callers reset it again when they are done stepping.
+    sqlite3_stmt* get_cached_statement(const String& query);
+    void clear_statement_cache();
+    // Adding a listener drops the statement cache, so that cached statements
+    // are compiled again with the listener's watched tables in mind.
+    void add_update_listener(SQLiteUpdateListener* listener);
+    void remove_update_listener(SQLiteUpdateListener* listener);
+    // Runs before the connection's own authorizer, which must stay installed:
+    // use this instead of sqlite3_set_authorizer() on get_handle(). Like
+    // sqlite3_set_authorizer(), the callback runs on whichever thread compiles
+    // a statement.
+    void set_authorizer(Authorizer callback, void* user_data);
+    // Compiles `query` without running it and adds the tables it reads.
+    bool get_read_tables(const String& query, HashSet<String>& r_tables);
 };
+
+VARIANT_ENUM_CAST(SQLiteBinding::TempStore);
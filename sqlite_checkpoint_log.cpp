@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_checkpoint_log.h"
+
+#include "core/error/error_macros.h"
+#include "core/string/ustring.h"
+
+#include <sqlite3.h>
+
+SQLiteCheckpointLog::SQLiteCheckpointLog(sqlite3* p_db, int p_max_checkpoints) :
+        db(p_db), max_checkpoints(MAX(p_max_checkpoints, 1)) {
+}
+
+SQLiteCheckpointLog::~SQLiteCheckpointLog() {
+    _drop_entries_after(-1);
+    if (session != nullptr) {
+        sqlite3session_delete(session);
+    }
+}
+
+static int read_schema_version(sqlite3* db) {
+    sqlite3_stmt* stmt = nullptr;
+    int version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA schema_version", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+// Rolling back restores rows the database held before, so conflicts only
+// come from changes made behind the log's back; the checkpoint wins.
+static int replace_on_conflict(void* user_data, int conflict, sqlite3_changeset_iter* iter) {
+    return conflict == SQLITE_CHANGESET_DATA || conflict == SQLITE_CHANGESET_CONFLICT ? SQLITE_CHANGESET_REPLACE
+                                                                                      : SQLITE_CHANGESET_OMIT;
+}
+
+bool SQLiteCheckpointLog::_reset_session() {
+    if (session != nullptr) {
+        sqlite3session_delete(session);
+        session = nullptr;
+    }
+    if (sqlite3session_create(db, "main", &session) != SQLITE_OK) {
+        return false;
+    }
+    int track_rowid = 1;
+    sqlite3session_object_config(session, SQLITE_SESSION_OBJCONFIG_ROWID, &track_rowid);
+    return sqlite3session_attach(session, nullptr) == SQLITE_OK;
+}
+
+void SQLiteCheckpointLog::_drop_entries_after(int64_t id) {
+    while (!entries.is_empty() && entries[entries.size() - 1].id > id) {
+        sqlite3_free(entries[entries.size() - 1].changeset);
+        entries.resize(entries.size() - 1);
+    }
+}
+
+void SQLiteCheckpointLog::_drop_oldest() {
+    sqlite3_free(entries[0].changeset);
+    entries.remove_at(0);
+}
+
+bool SQLiteCheckpointLog::start() {
+    schema_version = read_schema_version(db);
+    ERR_FAIL_COND_V_MSG(!_reset_session(), false, "Failed to record changes: " + String::utf8(sqlite3_errmsg(db)));
+    return true;
+}
+
+int64_t SQLiteCheckpointLog::checkpoint() {
+    ERR_FAIL_COND_V_MSG(!sqlite3_get_autocommit(db), -1, "Cannot take a checkpoint inside a transaction");
+    Entry entry;
+    entry.id = latest + 1;
+    const int version = read_schema_version(db);
+    const bool schema_changed = version != schema_version;
+    if (schema_changed) {
+        // Older changesets no longer match the tables; this checkpoint
+        // becomes the oldest one that can be restored.
+        _drop_entries_after(-1);
+        schema_version = version;
+    } else if (sqlite3session_changeset(session, &entry.size, &entry.changeset) != SQLITE_OK) {
+        print_error("Failed to take checkpoint: " + String::utf8(sqlite3_errmsg(db)));
+        return -1;
+    }
+    if (!_reset_session()) {
+        sqlite3_free(entry.changeset);
+        print_error("Failed to record changes: " + String::utf8(sqlite3_errmsg(db)));
+        return -1;
+    }
+    latest = entry.id;
+    if (!schema_changed) {
+        // Empty when nothing changed, which keeps the ids contiguous.
+        entries.push_back(entry);
+    }
+    // The oldest restorable checkpoint is the one before entries[0].
+    while (entries.size() >= uint32_t(max_checkpoints)) {
+        _drop_oldest();
+    }
+    return latest;
+}
+
+bool SQLiteCheckpointLog::rollback_to(int64_t id) {
+    ERR_FAIL_COND_V_MSG(id < get_oldest() || id > latest, false, "Checkpoint " + itos(id) + " is not available");
+    ERR_FAIL_COND_V_MSG(!sqlite3_get_autocommit(db), false, "Cannot roll back inside a transaction");
+    ERR_FAIL_COND_V_MSG(read_schema_version(db) != schema_version, false,
+        "The schema changed since the last checkpoint");
+
+    int size = 0;
+    void* pending = nullptr;
+    ERR_FAIL_COND_V(sqlite3session_changeset(session, &size, &pending) != SQLITE_OK, false);
+    // The rollback itself must not end up in the next checkpoint.
+    sqlite3session_enable(session, 0);
+
+    bool ok = sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) == SQLITE_OK;
+    const auto undo = [&](int changeset_size, void* changeset) {
+        if (!ok || changeset_size == 0) {
+            return;
+        }
+        int inverted_size = 0;
+        void* inverted = nullptr;
+        ok = sqlite3changeset_invert(changeset_size, changeset, &inverted_size, &inverted) == SQLITE_OK &&
+             sqlite3changeset_apply(db, inverted_size, inverted, nullptr, &replace_on_conflict, nullptr) == SQLITE_OK;
+        sqlite3_free(inverted);
+    };
+    undo(size, pending);
+    for (int64_t i = int64_t(entries.size()) - 1; i >= 0 && entries[i].id > id; --i) {
+        undo(entries[i].size, entries[i].changeset);
+    }
+    sqlite3_free(pending);
+    ok = ok && sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        print_error("Failed to roll back to checkpoint " + itos(id) + ": " + String::utf8(sqlite3_errmsg(db)));
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        sqlite3session_enable(session, 1);
+        return false;
+    }
+
+    _drop_entries_after(id);
+    latest = id;
+    return _reset_session();
+}
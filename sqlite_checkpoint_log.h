@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/templates/local_vector.h"
+
+struct sqlite3;
+struct sqlite3_session;
+
+// Numbered checkpoints of a connection's rows, kept as the changesets
+// between consecutive checkpoints. Taking a checkpoint costs time in the
+// number of rows changed since the last one, not in the database size, and
+// rolling back applies the inverted changesets newest first. Schema changes
+// are not recorded: they drop the checkpoints taken before them.
+class SQLiteCheckpointLog {
+    struct Entry {
+        int64_t id = 0;
+        int size = 0;
+        void* changeset = nullptr;
+    };
+
+    sqlite3* db = nullptr;
+    sqlite3_session* session = nullptr;
+    // Oldest first; entry i holds the changes from checkpoint id - 1 to id.
+    LocalVector<Entry> entries;
+    int max_checkpoints = 0;
+    int64_t latest = 0;
+    int schema_version = -1;
+
+    bool _reset_session();
+    void _drop_entries_after(int64_t id);
+    void _drop_oldest();
+
+public:
+    SQLiteCheckpointLog(sqlite3* db, int max_checkpoints);
+    ~SQLiteCheckpointLog();
+
+    bool start();
+    // Returns the new checkpoint's id, or -1 inside a transaction.
+    int64_t checkpoint();
+    bool rollback_to(int64_t id);
+
+    int64_t get_latest() const { return latest; }
+    int64_t get_oldest() const { return entries.is_empty() ? latest : entries[0].id - 1; }
+};
@@ -0,0 +1,678 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_compressed_vfs.h"
+#include "sqlite_utils.h"
+
+#include "core/io/file_access.h"
+#include "core/io/marshalls.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+#include <sqlite3.h>
+
+#include <cstring>
+
+namespace SQLiteCompressedVFS {
+
+static const char* VFS_NAME = "godot_compressed";
+static const uint8_t MAGIC[8] = { 'G', 'D', 'C', 'M', 'P', 'R', 'S', '2' };
+static const uint64_t FREE_RECORD = UINT64_MAX;
+
+enum {
+    HEADER_SIZE = 64,
+    LABEL_SIZE = 24,
+    INDEX_ENTRY_SIZE = 24,
+    // Record capacities are rounded up to this, so freed records of similar
+    // size can be reused.
+    GRANULE = 256,
+};
+
+// Header layout, little endian:
+//   0  magic
+//   8  page size (u32)
+//   12 compression mode (u32)
+//   16 logical database size (u64)
+//   24 end of the last record (u64)
+//   32 index offset, 0 while the index is stale (u64)
+//   40 index entry count (u64)
+//   48 next label sequence number (u64)
+//
+// Label layout: page number (u64), sequence number (u64), stored size (u32),
+// capacity (u32). A moved page is labelled in its new record before the old
+// one is freed, so after a crash between the two a scan finds both; the
+// label with the higher sequence number is the current one.
+struct Record {
+    uint64_t offset = 0;
+    uint32_t stored = 0;
+    uint32_t capacity = 0;
+};
+
+struct Compressed {
+    // Exactly one is set: `file` for writable databases, `pack` otherwise.
+    sqlite3_file* file = nullptr;
+    Ref<FileAccess> pack;
+
+    uint32_t page_size = 0;
+    Compression::Mode mode = Compression::MODE_ZSTD;
+    uint64_t size = 0;
+    uint64_t data_end = HEADER_SIZE;
+    uint64_t index_offset = 0;
+    uint64_t sequence = 0;
+    // Set by the first write; the index is rewritten on close.
+    bool dirty = false;
+
+    HashMap<uint64_t, Record> pages;
+    // Free record offsets by capacity / GRANULE.
+    LocalVector<LocalVector<uint64_t>> free_records;
+
+    LocalVector<uint8_t> packed;
+    LocalVector<uint8_t> scratch;
+    // The last page decoded for a partial read, e.g. the database header.
+    LocalVector<uint8_t> cached_page;
+    int64_t cached = -1;
+};
+
+struct CompressedFile {
+    sqlite3_file base;
+    Compressed* compressed;
+};
+
+static sqlite3_vfs* default_vfs = nullptr;
+
+static Compressed* get(sqlite3_file* file) {
+    return reinterpret_cast<CompressedFile*>(file)->compressed;
+}
+
+static int store_read(Compressed* c, void* buffer, uint64_t amount, uint64_t offset) {
+    if (c->file != nullptr) {
+        return c->file->pMethods->xRead(c->file, buffer, amount, offset);
+    }
+    c->pack->seek(offset);
+    return c->pack->get_buffer(static_cast<uint8_t*>(buffer), amount) == amount ? SQLITE_OK : SQLITE_IOERR_SHORT_READ;
+}
+
+static int store_write(Compressed* c, const void* buffer, uint64_t amount, uint64_t offset) {
+    if (c->file == nullptr) {
+        return SQLITE_READONLY;
+    }
+    return c->file->pMethods->xWrite(c->file, buffer, amount, offset);
+}
+
+static int write_header(Compressed* c, uint64_t index_count = 0) {
+    uint8_t header[HEADER_SIZE] = {};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    encode_uint32(c->page_size, header + 8);
+    encode_uint32(c->mode, header + 12);
+    encode_uint64(c->size, header + 16);
+    encode_uint64(c->data_end, header + 24);
+    encode_uint64(c->index_offset, header + 32);
+    encode_uint64(index_count, header + 40);
+    encode_uint64(c->sequence, header + 48);
+    return store_write(c, header, HEADER_SIZE, 0);
+}
+
+static int write_label(Compressed* c, uint64_t offset, uint64_t page, uint32_t stored, uint32_t capacity) {
+    uint8_t label[LABEL_SIZE];
+    encode_uint64(page, label);
+    encode_uint64(++c->sequence, label + 8);
+    encode_uint32(stored, label + 16);
+    encode_uint32(capacity, label + 20);
+    return store_write(c, label, LABEL_SIZE, offset);
+}
+
+static void set_page_size(Compressed* c, uint32_t page_size) {
+    c->page_size = page_size;
+    c->free_records.resize(page_size / GRANULE + 1);
+    c->packed.resize(MAX(int64_t(page_size), int64_t(Compression::get_max_compressed_buffer_size(page_size, c->mode))));
+    c->scratch.resize(page_size);
+    c->cached_page.resize(page_size);
+}
+
+static void add_record(Compressed* c, uint64_t page, const Record& record) {
+    if (page == FREE_RECORD) {
+        c->free_records[record.capacity / GRANULE].push_back(record.offset);
+    } else {
+        c->pages.insert(page, record);
+    }
+}
+
+static int read_page(Compressed* c, uint64_t page, uint8_t* out) {
+    const Record* record = c->pages.getptr(page);
+    if (record == nullptr) {
+        memset(out, 0, c->page_size);
+        return SQLITE_OK;
+    }
+    if (record->stored == c->page_size) {
+        return store_read(c, out, c->page_size, record->offset + LABEL_SIZE);
+    }
+    const int rc = store_read(c, c->packed.ptr(), record->stored, record->offset + LABEL_SIZE);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    const int decoded = Compression::decompress(out, c->page_size, c->packed.ptr(), record->stored, c->mode);
+    return decoded == int(c->page_size) ? SQLITE_OK : SQLITE_CORRUPT;
+}
+
+// Invalidates the index stored in the file before the first change.
+static int begin_write(Compressed* c) {
+    if (c->dirty) {
+        return SQLITE_OK;
+    }
+    c->dirty = true;
+    c->index_offset = 0;
+    return write_header(c);
+}
+
+static int write_page(Compressed* c, uint64_t page, const uint8_t* data) {
+    if (c->cached == int64_t(page)) {
+        c->cached = -1;
+    }
+    // Pages that do not shrink are stored as they are.
+    const uint8_t* payload = data;
+    uint32_t stored = c->page_size;
+    const int packed = Compression::compress(c->packed.ptr(), data, c->page_size, c->mode);
+    if (packed > 0 && uint32_t(packed) < c->page_size) {
+        payload = c->packed.ptr();
+        stored = packed;
+    }
+
+    Record* existing = c->pages.getptr(page);
+    if (existing != nullptr && existing->capacity >= stored) {
+        existing->stored = stored;
+        int rc = store_write(c, payload, stored, existing->offset + LABEL_SIZE);
+        if (rc == SQLITE_OK) {
+            rc = write_label(c, existing->offset, page, stored, existing->capacity);
+        }
+        return rc;
+    }
+
+    const uint32_t needed = (stored + GRANULE - 1) / GRANULE;
+    Record record;
+    for (uint32_t bucket = needed; bucket < c->free_records.size(); ++bucket) {
+        LocalVector<uint64_t>& free = c->free_records[bucket];
+        if (!free.is_empty()) {
+            record.offset = free[free.size() - 1];
+            record.capacity = bucket * GRANULE;
+            free.remove_at(free.size() - 1);
+            break;
+        }
+    }
+    const bool append = record.capacity == 0;
+    if (append) {
+        record.offset = c->data_end;
+        record.capacity = needed * GRANULE;
+    }
+    record.stored = stored;
+
+    int rc = store_write(c, payload, stored, record.offset + LABEL_SIZE);
+    if (rc == SQLITE_OK) {
+        rc = write_label(c, record.offset, page, stored, record.capacity);
+    }
+    if (rc != SQLITE_OK) {
+        if (!append) {
+            c->free_records[record.capacity / GRANULE].push_back(record.offset);
+        }
+        return rc;
+    }
+    if (existing != nullptr) {
+        rc = write_label(c, existing->offset, FREE_RECORD, 0, existing->capacity);
+        c->free_records[existing->capacity / GRANULE].push_back(existing->offset);
+    }
+    c->pages.insert(page, record);
+    if (append) {
+        c->data_end += LABEL_SIZE + record.capacity;
+        rc = write_header(c);
+    }
+    return rc;
+}
+
+static int write_index(Compressed* c) {
+    LocalVector<uint8_t> index;
+    uint64_t count = 0;
+    const auto add_entry = [&](uint64_t page, uint64_t offset, uint32_t stored, uint32_t capacity) {
+        index.resize(index.size() + INDEX_ENTRY_SIZE);
+        uint8_t* entry = index.ptr() + index.size() - INDEX_ENTRY_SIZE;
+        encode_uint64(page, entry);
+        encode_uint64(offset, entry + 8);
+        encode_uint32(stored, entry + 16);
+        encode_uint32(capacity, entry + 20);
+        count++;
+    };
+    for (const KeyValue<uint64_t, Record>& E : c->pages) {
+        add_entry(E.key, E.value.offset, E.value.stored, E.value.capacity);
+    }
+    for (uint32_t bucket = 0; bucket < c->free_records.size(); ++bucket) {
+        for (uint64_t offset : c->free_records[bucket]) {
+            add_entry(FREE_RECORD, offset, 0, bucket * GRANULE);
+        }
+    }
+    // The index must be on disk before the header points at it.
+    int rc = count ? store_write(c, index.ptr(), index.size(), c->data_end) : SQLITE_OK;
+    if (rc == SQLITE_OK) {
+        rc = c->file->pMethods->xSync(c->file, SQLITE_SYNC_NORMAL);
+    }
+    if (rc == SQLITE_OK) {
+        c->index_offset = c->data_end;
+        rc = write_header(c, count);
+    }
+    if (rc == SQLITE_OK) {
+        rc = c->file->pMethods->xSync(c->file, SQLITE_SYNC_NORMAL);
+    }
+    return rc;
+}
+
+static int compressed_close(sqlite3_file* file) {
+    Compressed* c = get(file);
+    int rc = SQLITE_OK;
+    if (c->file != nullptr) {
+        if (c->dirty && c->page_size != 0) {
+            rc = write_index(c);
+        }
+        const int close_rc = c->file->pMethods ? c->file->pMethods->xClose(c->file) : SQLITE_OK;
+        rc = rc == SQLITE_OK ? close_rc : rc;
+        sqlite3_free(c->file);
+    }
+    memdelete(c);
+    return rc;
+}
+
+static int compressed_read(sqlite3_file* file, void* buffer, int amount, sqlite3_int64 offset) {
+    Compressed* c = get(file);
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    uint64_t available = 0;
+    if (uint64_t(offset) < c->size) {
+        available = MIN(uint64_t(amount), c->size - offset);
+    }
+    memset(out + available, 0, amount - available);
+
+    uint64_t position = offset;
+    const uint64_t end = offset + available;
+    while (position < end) {
+        const uint64_t page = position / c->page_size;
+        const uint64_t in_page = position % c->page_size;
+        const uint64_t count = MIN(uint64_t(c->page_size) - in_page, end - position);
+        if (in_page == 0 && count == c->page_size) {
+            const int rc = read_page(c, page, out);
+            if (rc != SQLITE_OK) {
+                return rc;
+            }
+        } else {
+            if (c->cached != int64_t(page)) {
+                c->cached = -1;
+                const int rc = read_page(c, page, c->cached_page.ptr());
+                if (rc != SQLITE_OK) {
+                    return rc;
+                }
+                c->cached = page;
+            }
+            memcpy(out, c->cached_page.ptr() + in_page, count);
+        }
+        out += count;
+        position += count;
+    }
+    return available == uint64_t(amount) ? SQLITE_OK : SQLITE_IOERR_SHORT_READ;
+}
+
+static int compressed_write(sqlite3_file* file, const void* buffer, int amount, sqlite3_int64 offset) {
+    Compressed* c = get(file);
+    if (c->page_size == 0) {
+        // A new database: the pager writes whole pages, so the first write
+        // fixes the page size.
+        if (amount < 512 || amount > 65536 || (amount & (amount - 1)) != 0 || offset % amount != 0) {
+            return SQLITE_IOERR_WRITE;
+        }
+        set_page_size(c, amount);
+    }
+    if (begin_write(c) != SQLITE_OK) {
+        return SQLITE_IOERR_WRITE;
+    }
+    const uint8_t* in = static_cast<const uint8_t*>(buffer);
+    uint64_t position = offset;
+    const uint64_t end = offset + amount;
+    while (position < end) {
+        const uint64_t page = position / c->page_size;
+        const uint64_t in_page = position % c->page_size;
+        const uint64_t count = MIN(uint64_t(c->page_size) - in_page, end - position);
+        int rc;
+        if (in_page == 0 && count == c->page_size) {
+            rc = write_page(c, page, in);
+        } else {
+            rc = read_page(c, page, c->scratch.ptr());
+            if (rc == SQLITE_OK) {
+                memcpy(c->scratch.ptr() + in_page, in, count);
+                rc = write_page(c, page, c->scratch.ptr());
+            }
+        }
+        if (rc != SQLITE_OK) {
+            return SQLITE_IOERR_WRITE;
+        }
+        in += count;
+        position += count;
+    }
+    if (end > c->size) {
+        c->size = end;
+        return write_header(c);
+    }
+    return SQLITE_OK;
+}
+
+static int compressed_truncate(sqlite3_file* file, sqlite3_int64 size) {
+    Compressed* c = get(file);
+    if (uint64_t(size) >= c->size) {
+        return SQLITE_OK;
+    }
+    if (begin_write(c) != SQLITE_OK) {
+        return SQLITE_IOERR_TRUNCATE;
+    }
+    const uint64_t in_page = size % c->page_size;
+    if (in_page != 0) {
+        const uint64_t page = size / c->page_size;
+        int rc = read_page(c, page, c->scratch.ptr());
+        if (rc == SQLITE_OK) {
+            memset(c->scratch.ptr() + in_page, 0, c->page_size - in_page);
+            rc = write_page(c, page, c->scratch.ptr());
+        }
+        if (rc != SQLITE_OK) {
+            return SQLITE_IOERR_TRUNCATE;
+        }
+    }
+    const uint64_t first_dropped = (size + c->page_size - 1) / c->page_size;
+    LocalVector<uint64_t> dropped;
+    for (const KeyValue<uint64_t, Record>& E : c->pages) {
+        if (E.key >= first_dropped) {
+            dropped.push_back(E.key);
+        }
+    }
+    for (uint64_t page : dropped) {
+        const Record record = c->pages[page];
+        if (write_label(c, record.offset, FREE_RECORD, 0, record.capacity) != SQLITE_OK) {
+            return SQLITE_IOERR_TRUNCATE;
+        }
+        c->pages.erase(page);
+        c->free_records[record.capacity / GRANULE].push_back(record.offset);
+    }
+    if (c->cached >= int64_t(first_dropped)) {
+        c->cached = -1;
+    }
+    c->size = size;
+    return write_header(c) == SQLITE_OK ? SQLITE_OK : SQLITE_IOERR_TRUNCATE;
+}
+
+static int compressed_sync(sqlite3_file* file, int flags) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xSync(c->file, flags) : SQLITE_OK;
+}
+
+static int compressed_file_size(sqlite3_file* file, sqlite3_int64* size) {
+    *size = get(file)->size;
+    return SQLITE_OK;
+}
+
+// Writable databases lock the underlying file; read-only ones are immutable.
+static int compressed_lock(sqlite3_file* file, int lock) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xLock(c->file, lock) : SQLITE_OK;
+}
+
+static int compressed_unlock(sqlite3_file* file, int lock) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xUnlock(c->file, lock) : SQLITE_OK;
+}
+
+static int compressed_check_reserved_lock(sqlite3_file* file, int* result) {
+    Compressed* c = get(file);
+    if (c->file == nullptr) {
+        *result = 0;
+        return SQLITE_OK;
+    }
+    return c->file->pMethods->xCheckReservedLock(c->file, result);
+}
+
+static int compressed_file_control(sqlite3_file* file, int op, void* arg) {
+    // Size hints and chunk sizes would resize the underlying file, which
+    // does not share offsets with the database.
+    return SQLITE_NOTFOUND;
+}
+
+static int compressed_sector_size(sqlite3_file* file) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xSectorSize(c->file) : 4096;
+}
+
+static int compressed_device_characteristics(sqlite3_file* file) {
+    return get(file)->file ? 0 : SQLITE_IOCAP_IMMUTABLE;
+}
+
+static int compressed_shm_map(sqlite3_file* file, int region, int size, int extend, void volatile** memory) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xShmMap(c->file, region, size, extend, memory) : SQLITE_READONLY_CANTINIT;
+}
+
+static int compressed_shm_lock(sqlite3_file* file, int offset, int count, int flags) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xShmLock(c->file, offset, count, flags) : SQLITE_OK;
+}
+
+static void compressed_shm_barrier(sqlite3_file* file) {
+    Compressed* c = get(file);
+    if (c->file) {
+        c->file->pMethods->xShmBarrier(c->file);
+    }
+}
+
+static int compressed_shm_unmap(sqlite3_file* file, int delete_flag) {
+    Compressed* c = get(file);
+    return c->file ? c->file->pMethods->xShmUnmap(c->file, delete_flag) : SQLITE_OK;
+}
+
+// Version 2: no xFetch, there are no uncompressed pages to map.
+static const sqlite3_io_methods compressed_methods = {
+    2,
+    compressed_close,
+    compressed_read,
+    compressed_write,
+    compressed_truncate,
+    compressed_sync,
+    compressed_file_size,
+    compressed_lock,
+    compressed_unlock,
+    compressed_check_reserved_lock,
+    compressed_file_control,
+    compressed_sector_size,
+    compressed_device_characteristics,
+    compressed_shm_map,
+    compressed_shm_lock,
+    compressed_shm_barrier,
+    compressed_shm_unmap,
+    nullptr,
+    nullptr,
+};
+
+// Loads the header and the page index, from the stored index when the file
+// was closed cleanly and by scanning the record labels otherwise.
+static int load(Compressed* c) {
+    uint64_t file_size = 0;
+    if (c->file != nullptr) {
+        sqlite3_int64 length = 0;
+        const int rc = c->file->pMethods->xFileSize(c->file, &length);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        file_size = length;
+    } else {
+        file_size = c->pack->get_length();
+    }
+    if (file_size < HEADER_SIZE) {
+        // A new database; the header is written with the first page.
+        return c->file ? SQLITE_OK : SQLITE_CANTOPEN;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    int rc = store_read(c, header, HEADER_SIZE, 0);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0) {
+        sqlite3_log(SQLITE_CANTOPEN, "not a compressed database");
+        return SQLITE_CANTOPEN;
+    }
+    // Both size the page buffers, so a damaged header must not reach them.
+    const uint32_t page_size = decode_uint32(header + 8);
+    const uint32_t mode = decode_uint32(header + 12);
+    if (page_size < 512 || page_size > 65536 || (page_size & (page_size - 1)) != 0 ||
+            mode > Compression::MODE_BROTLI) {
+        return SQLITE_CORRUPT;
+    }
+    c->mode = Compression::Mode(mode);
+    set_page_size(c, page_size);
+    c->size = decode_uint64(header + 16);
+    c->data_end = decode_uint64(header + 24);
+    c->index_offset = decode_uint64(header + 32);
+    const uint64_t index_count = decode_uint64(header + 40);
+    c->sequence = decode_uint64(header + 48);
+
+    if (c->index_offset != 0) {
+        LocalVector<uint8_t> index;
+        index.resize(index_count * INDEX_ENTRY_SIZE);
+        rc = index_count ? store_read(c, index.ptr(), index.size(), c->index_offset) : SQLITE_OK;
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        c->pages.reserve(index_count);
+        for (uint64_t i = 0; i < index_count; ++i) {
+            const uint8_t* entry = index.ptr() + i * INDEX_ENTRY_SIZE;
+            Record record;
+            record.offset = decode_uint64(entry + 8);
+            record.stored = decode_uint32(entry + 16);
+            record.capacity = decode_uint32(entry + 20);
+            add_record(c, decode_uint64(entry), record);
+        }
+        return SQLITE_OK;
+    }
+
+    // Sequence number of the label each page was taken from.
+    HashMap<uint64_t, uint64_t> labelled;
+    uint64_t offset = HEADER_SIZE;
+    while (offset + LABEL_SIZE <= c->data_end) {
+        uint8_t label[LABEL_SIZE];
+        rc = store_read(c, label, LABEL_SIZE, offset);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        Record record;
+        record.offset = offset;
+        record.stored = decode_uint32(label + 16);
+        record.capacity = decode_uint32(label + 20);
+        if (record.capacity == 0 || record.capacity % GRANULE != 0 || record.capacity > c->page_size) {
+            return SQLITE_CORRUPT;
+        }
+        uint64_t page = decode_uint64(label);
+        const uint64_t sequence = decode_uint64(label + 8);
+        c->sequence = MAX(c->sequence, sequence);
+        if (page != FREE_RECORD && page * c->page_size >= c->size) {
+            page = FREE_RECORD;
+        }
+        const uint64_t* previous = page != FREE_RECORD ? labelled.getptr(page) : nullptr;
+        if (previous != nullptr && *previous > sequence) {
+            page = FREE_RECORD;
+        } else if (previous != nullptr) {
+            // The earlier record is the stale copy of a page that was moved.
+            add_record(c, FREE_RECORD, c->pages[page]);
+        }
+        if (page != FREE_RECORD) {
+            labelled[page] = sequence;
+        }
+        add_record(c, page, record);
+        offset += LABEL_SIZE + record.capacity;
+    }
+    return SQLITE_OK;
+}
+
+static int compressed_open(sqlite3_vfs* vfs, sqlite3_filename name, sqlite3_file* file, int flags, int* out_flags) {
+    if (!(flags & SQLITE_OPEN_MAIN_DB) || name == nullptr) {
+        // szOsFile is at least the default VFS's, so its files fit in place.
+        return default_vfs->xOpen(default_vfs, name, file, flags, out_flags);
+    }
+    file->pMethods = nullptr;
+    Compressed* c = memnew(Compressed);
+    int rc = SQLITE_OK;
+    const char* pack_path = sqlite3_uri_parameter(name, "pack");
+    if (pack_path != nullptr) {
+        c->pack = FileAccess::open(String::utf8(pack_path), FileAccess::READ);
+        rc = c->pack.is_valid() ? SQLITE_OK : SQLITE_CANTOPEN;
+        if (out_flags != nullptr) {
+            *out_flags = SQLITE_OPEN_READONLY;
+        }
+    } else {
+        c->mode = Compression::Mode(sqlite3_uri_int64(name, "compression", Compression::MODE_ZSTD));
+        c->file = static_cast<sqlite3_file*>(sqlite3_malloc(default_vfs->szOsFile));
+        if (c->file == nullptr) {
+            rc = SQLITE_NOMEM;
+        } else {
+            memset(c->file, 0, default_vfs->szOsFile);
+            rc = default_vfs->xOpen(default_vfs, name, c->file, flags, out_flags);
+        }
+    }
+    if (rc == SQLITE_OK) {
+        rc = load(c);
+    }
+    if (rc != SQLITE_OK) {
+        if (c->file != nullptr && c->file->pMethods) {
+            c->file->pMethods->xClose(c->file);
+        }
+        sqlite3_free(c->file);
+        memdelete(c);
+        return rc;
+    }
+    reinterpret_cast<CompressedFile*>(file)->compressed = c;
+    file->pMethods = &compressed_methods;
+    return SQLITE_OK;
+}
+
+const char* get_name() {
+    static sqlite3_vfs vfs;
+    static Mutex mutex;
+    MutexLock lock(mutex);
+    if (default_vfs == nullptr) {
+        default_vfs = sqlite3_vfs_find(nullptr);
+        vfs = *default_vfs;
+        vfs.zName = VFS_NAME;
+        vfs.pNext = nullptr;
+        vfs.szOsFile = MAX(default_vfs->szOsFile, int(sizeof(CompressedFile)));
+        vfs.xOpen = compressed_open;
+        sqlite3_vfs_register(&vfs, 0);
+    }
+    return VFS_NAME;
+}
+
+String make_uri(const String& path, Compression::Mode mode) {
+    return SQLiteUtils::file_uri(path) + "?compression=" + itos(mode);
+}
+
+String make_read_only_uri(const String& path) {
+    // The name only has to be unique; all reads go through FileAccess.
+    return SQLiteUtils::file_uri("/" + path.md5_text()) + "?immutable=1&pack=" + path.uri_encode();
+}
+
+}
@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/io/compression.h"
+#include "core/string/ustring.h"
+
+// A VFS that stores every database page compressed with Godot's Compression.
+// A page index maps page numbers to records, so pages are still read and
+// written one at a time. Writable files live on the file system and use the
+// default VFS for locking; read-only files are read through FileAccess, so
+// they can ship in res:// or a PCK.
+//
+// The file starts with a small header followed by records, each a 24 byte
+// label (page number, sequence number, stored size, capacity) and the page
+// data. Records are rewritten in place while the page still fits, otherwise
+// moved; freed records are reused, and when a scan finds two labels for the
+// same page the newer one wins. On a clean close the index is appended after the last
+// record so the next open reads it in one go instead of scanning.
+//
+// The page index is built once at open, so a writable file must only be used
+// by one connection at a time; SQLiteBinding::open_compressed() holds an
+// exclusive lock on it until close.
+namespace SQLiteCompressedVFS {
+
+// Registers the VFS on first use and returns its name.
+const char* get_name();
+// The URI for a writable database at the absolute path `path`, compressing
+// new pages with `mode`.
+String make_uri(const String& path, Compression::Mode mode);
+// The URI for a read-only database at any path FileAccess can open.
+String make_read_only_uri(const String& path);
+
+}
@@ -0,0 +1,263 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_connection_manager.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+#include "core/os/os.h"
+
+#include <sqlite3.h>
+
+void SQLiteConnectionManager::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("acquire", "path"), &SQLiteConnectionManager::acquire);
+    ClassDB::bind_method(D_METHOD("release", "path"), &SQLiteConnectionManager::release);
+    ClassDB::bind_method(D_METHOD("close_idle"), &SQLiteConnectionManager::close_idle);
+    ClassDB::bind_method(D_METHOD("close_all"), &SQLiteConnectionManager::close_all);
+    ClassDB::bind_method(D_METHOD("set_max_open_handles", "count"), &SQLiteConnectionManager::set_max_open_handles);
+    ClassDB::bind_method(D_METHOD("get_max_open_handles"), &SQLiteConnectionManager::get_max_open_handles);
+    ClassDB::bind_method(D_METHOD("set_memory_budget", "bytes"), &SQLiteConnectionManager::set_memory_budget);
+    ClassDB::bind_method(D_METHOD("get_memory_budget"), &SQLiteConnectionManager::get_memory_budget);
+    ClassDB::bind_method(D_METHOD("set_idle_timeout", "msec"), &SQLiteConnectionManager::set_idle_timeout);
+    ClassDB::bind_method(D_METHOD("get_idle_timeout"), &SQLiteConnectionManager::get_idle_timeout);
+    ClassDB::bind_method(D_METHOD("get_open_count"), &SQLiteConnectionManager::get_open_count);
+    ClassDB::bind_method(D_METHOD("get_metrics"), &SQLiteConnectionManager::get_metrics);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_open_handles"), "set_max_open_handles", "get_max_open_handles");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "memory_budget"), "set_memory_budget", "get_memory_budget");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "idle_timeout"), "set_idle_timeout", "get_idle_timeout");
+}
+
+SQLiteConnectionManager::SQLiteConnectionManager() = default;
+SQLiteConnectionManager::~SQLiteConnectionManager() {
+    reaper_exit.set();
+    if (reaper_thread.is_started()) {
+        reaper_thread.wait_to_finish();
+    }
+    close_all();
+}
+
+String SQLiteConnectionManager::_normalize_path(const String& path) {
+    return path.strip_edges().simplify_path();
+}
+
+void SQLiteConnectionManager::_reaper_loop(void* user_data) {
+    SQLiteConnectionManager* self = static_cast<SQLiteConnectionManager*>(user_data);
+    uint64_t next_sweep_usec = 0;
+    while (!self->reaper_exit.is_set()) {
+        // Sleep in short slices so the destructor does not wait for a sweep.
+        OS::get_singleton()->delay_usec(100000);
+        const int timeout_msec = self->idle_timeout_msec.get();
+        const uint64_t now = OS::get_singleton()->get_ticks_usec();
+        if (timeout_msec <= 0 || now < next_sweep_usec) {
+            continue;
+        }
+        // Connections are not closed from this thread: scripts may be about to
+        // use them, and close() can run PRAGMA optimize and listeners.
+        if (!self->reap_queued.is_set() && self->_has_expired()) {
+            self->reap_queued.set();
+            callable_mp(self, &SQLiteConnectionManager::_reap).call_deferred();
+        }
+        next_sweep_usec = now + MAX(timeout_msec / 4, 100) * 1000;
+    }
+}
+
+bool SQLiteConnectionManager::_is_idle(const Handle& handle) const {
+    // A reference held outside the manager counts as a lease as well.
+    return handle.leases == 0 && handle.db->get_reference_count() == 1;
+}
+
+bool SQLiteConnectionManager::_has_expired() const {
+    MutexLock lock(mutex);
+    const uint64_t now = OS::get_singleton()->get_ticks_usec();
+    const uint64_t timeout_usec = static_cast<uint64_t>(MAX(idle_timeout_msec.get(), 0)) * 1000;
+    for (const KeyValue<String, Handle>& E : handles) {
+        if (_is_idle(E.value) && now - E.value.last_used_usec >= timeout_usec) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SQLiteConnectionManager::_reap() {
+    reap_queued.clear();
+    if (idle_timeout_msec.get() > 0) {
+        close_idle();
+    }
+}
+
+void SQLiteConnectionManager::_close_handle(const String& path) {
+    HashMap<String, Handle>::Iterator handle = handles.find(path);
+    ERR_FAIL_COND(!handle);
+    handle->value.db->close();
+    lru.erase(handle->value.lru);
+    handles.erase(path);
+    ++closes;
+}
+
+int64_t SQLiteConnectionManager::_get_memory_used_locked() const {
+    int64_t used = 0;
+    for (const KeyValue<String, Handle>& E : handles) {
+        int current = 0;
+        int highwater = 0;
+        sqlite3_db_status(E.value.db->get_handle(), SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0);
+        used += current;
+    }
+    return used;
+}
+
+void SQLiteConnectionManager::_enforce_budget_locked() {
+    int64_t memory_used = memory_budget > 0 ? _get_memory_used_locked() : 0;
+    List<String>::Element* E = lru.back();
+    while (E != nullptr &&
+            (handles.size() > static_cast<uint32_t>(max_open_handles) || (memory_budget > 0 && memory_used > memory_budget))) {
+        List<String>::Element* prev = E->prev();
+        const Handle& handle = handles[E->get()];
+        if (_is_idle(handle)) {
+            int current = 0;
+            int highwater = 0;
+            sqlite3_db_status(handle.db->get_handle(), SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0);
+            memory_used -= current;
+            const String path = E->get();
+            _close_handle(path);
+            ++evictions;
+        }
+        E = prev;
+    }
+}
+
+Ref<SQLiteBinding> SQLiteConnectionManager::acquire(const String& path) {
+    const String key = _normalize_path(path);
+    ERR_FAIL_COND_V(key.is_empty(), Ref<SQLiteBinding>());
+
+    MutexLock lock(mutex);
+    if (!reaper_thread.is_started()) {
+        reaper_thread.start(&SQLiteConnectionManager::_reaper_loop, this);
+    }
+
+    HashMap<String, Handle>::Iterator existing = handles.find(key);
+    if (existing) {
+        ++hits;
+        existing->value.leases++;
+        existing->value.last_used_usec = OS::get_singleton()->get_ticks_usec();
+        lru.move_to_front(existing->value.lru);
+        return existing->value.db;
+    }
+
+    ++misses;
+    Ref<SQLiteBinding> db;
+    db.instantiate();
+    if (!db->open(key)) {
+        return Ref<SQLiteBinding>();
+    }
+    ++opens;
+
+    Handle handle;
+    handle.db = db;
+    handle.leases = 1;
+    handle.last_used_usec = OS::get_singleton()->get_ticks_usec();
+    handle.lru = lru.push_front(key);
+    handles.insert(key, handle);
+
+    _enforce_budget_locked();
+    return db;
+}
+
+void SQLiteConnectionManager::release(const String& path) {
+    MutexLock lock(mutex);
+    HashMap<String, Handle>::Iterator handle = handles.find(_normalize_path(path));
+    ERR_FAIL_COND_MSG(!handle, "Database is not managed: " + path);
+    ERR_FAIL_COND_MSG(handle->value.leases <= 0, "Database is not leased: " + path);
+    handle->value.leases--;
+    handle->value.last_used_usec = OS::get_singleton()->get_ticks_usec();
+    if (handle->value.leases == 0) {
+        _enforce_budget_locked();
+    }
+}
+
+int SQLiteConnectionManager::close_idle() {
+    MutexLock lock(mutex);
+    const uint64_t now = OS::get_singleton()->get_ticks_usec();
+    const uint64_t timeout_usec = static_cast<uint64_t>(MAX(idle_timeout_msec.get(), 0)) * 1000;
+    LocalVector<String> expired;
+    for (const KeyValue<String, Handle>& E : handles) {
+        if (_is_idle(E.value) && now - E.value.last_used_usec >= timeout_usec) {
+            expired.push_back(E.key);
+        }
+    }
+    for (const String& path : expired) {
+        _close_handle(path);
+        ++idle_closes;
+    }
+    return expired.size();
+}
+
+void SQLiteConnectionManager::close_all() {
+    MutexLock lock(mutex);
+    while (!lru.is_empty()) {
+        const String path = lru.front()->get();
+        _close_handle(path);
+    }
+}
+
+void SQLiteConnectionManager::set_max_open_handles(int count) {
+    ERR_FAIL_COND(count < 1);
+    MutexLock lock(mutex);
+    max_open_handles = count;
+    _enforce_budget_locked();
+}
+
+void SQLiteConnectionManager::set_memory_budget(int64_t bytes) {
+    MutexLock lock(mutex);
+    memory_budget = MAX(bytes, 0);
+    _enforce_budget_locked();
+}
+
+void SQLiteConnectionManager::set_idle_timeout(int msec) {
+    idle_timeout_msec.set(msec);
+}
+
+int SQLiteConnectionManager::get_open_count() const {
+    MutexLock lock(mutex);
+    return handles.size();
+}
+
+Dictionary SQLiteConnectionManager::get_metrics() const {
+    MutexLock lock(mutex);
+    int leased = 0;
+    for (const KeyValue<String, Handle>& E : handles) {
+        if (E.value.leases > 0) {
+            ++leased;
+        }
+    }
+    Dictionary metrics;
+    metrics["open"] = handles.size();
+    metrics["leased"] = leased;
+    metrics["hits"] = hits;
+    metrics["misses"] = misses;
+    metrics["opens"] = opens;
+    metrics["closes"] = closes;
+    metrics["evictions"] = evictions;
+    metrics["idle_closes"] = idle_closes;
+    metrics["cache_memory"] = _get_memory_used_locked();
+    return metrics;
+}
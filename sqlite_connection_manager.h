@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/list.h"
+#include "core/templates/safe_refcount.h"
+
+// Keeps recently used connections open so that re-opening a database is a
+// lookup instead of an open, schema parse and cold page cache. Connections
+// are handed out as leases by path; idle ones are closed least recently used
+// first when the handle or memory budget is exceeded, and once they stayed
+// idle for longer than the idle timeout. A background thread watches for the
+// latter, but the connections are closed from the message queue, on the main
+// thread, like the rest of the manager's calls.
+//
+// A pooled connection also keeps its statement cache. Only run(), the typed
+// query API, insert_columns(), SQLiteUnitOfWork and SQLiteKV use that cache;
+// query() and the query_fetch_* functions prepare their statement on every
+// call.
+class SQLiteConnectionManager : public RefCounted {
+    GDCLASS(SQLiteConnectionManager, RefCounted);
+
+    struct Handle {
+        Ref<SQLiteBinding> db;
+        int leases = 0;
+        uint64_t last_used_usec = 0;
+        List<String>::Element* lru = nullptr;
+    };
+
+    mutable Mutex mutex;
+    HashMap<String, Handle> handles;
+    // Most recently used path first.
+    List<String> lru;
+
+    int max_open_handles = 256;
+    int64_t memory_budget = 0;
+    SafeNumeric<int> idle_timeout_msec{ 30000 };
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t opens = 0;
+    uint64_t closes = 0;
+    uint64_t evictions = 0;
+    uint64_t idle_closes = 0;
+
+    Thread reaper_thread;
+    SafeFlag reaper_exit;
+    SafeFlag reap_queued;
+
+    static void _reaper_loop(void* user_data);
+    static String _normalize_path(const String& path);
+    bool _is_idle(const Handle& handle) const;
+    bool _has_expired() const;
+    void _reap();
+    void _close_handle(const String& path);
+    void _enforce_budget_locked();
+    int64_t _get_memory_used_locked() const;
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteConnectionManager();
+    ~SQLiteConnectionManager();
+
+    Ref<SQLiteBinding> acquire(const String& path);
+    void release(const String& path);
+
+    int close_idle();
+    void close_all();
+
+    void set_max_open_handles(int count);
+    int get_max_open_handles() const { return max_open_handles; }
+    void set_memory_budget(int64_t bytes);
+    int64_t get_memory_budget() const { return memory_budget; }
+    void set_idle_timeout(int msec);
+    int get_idle_timeout() const { return idle_timeout_msec.get(); }
+
+    int get_open_count() const;
+    Dictionary get_metrics() const;
+};
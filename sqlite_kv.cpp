@@ -0,0 +1,180 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_kv.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/io/marshalls.h"
+#include "core/object/class_db.h"
+
+#include <sqlite3.h>
+
+void SQLiteKV::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("setup", "database", "table"), &SQLiteKV::setup, DEFVAL("kv"));
+    ClassDB::bind_method(D_METHOD("get_value", "key", "default"), &SQLiteKV::get_value, DEFVAL(Variant()));
+    ClassDB::bind_method(D_METHOD("put", "key", "value"), &SQLiteKV::put);
+    ClassDB::bind_method(D_METHOD("erase", "key"), &SQLiteKV::erase);
+    ClassDB::bind_method(D_METHOD("get_many", "keys"), &SQLiteKV::get_many);
+    ClassDB::bind_method(D_METHOD("put_many", "values"), &SQLiteKV::put_many);
+    ClassDB::bind_method(D_METHOD("scan_prefix", "prefix", "limit"), &SQLiteKV::scan_prefix, DEFVAL(-1));
+}
+
+SQLiteKV::SQLiteKV() = default;
+
+bool SQLiteKV::setup(const Ref<SQLiteBinding>& database, const String& table) {
+    ERR_FAIL_COND_V(database.is_null() || database->get_handle() == nullptr, false);
+    const String name = SQLiteUtils::quote_identifier(table);
+    if (!database->execute_script("CREATE TABLE IF NOT EXISTS " + name +
+            " (key TEXT PRIMARY KEY NOT NULL, value BLOB) WITHOUT ROWID")) {
+        return false;
+    }
+    db = database;
+    sql_get = "SELECT value FROM " + name + " WHERE key = ?";
+    sql_put = "INSERT INTO " + name + " (key, value) VALUES (?, ?) ON CONFLICT (key) DO UPDATE SET value = excluded.value";
+    sql_erase = "DELETE FROM " + name + " WHERE key = ?";
+    sql_scan = "SELECT key, value FROM " + name + " WHERE key >= ?1 AND key < ?2 ORDER BY key LIMIT ?3";
+    sql_scan_all = "SELECT key, value FROM " + name + " ORDER BY key LIMIT ?3";
+    return true;
+}
+
+sqlite3_stmt* SQLiteKV::_statement(const String& query) {
+    ERR_FAIL_COND_V_MSG(db.is_null() || db->get_handle() == nullptr, nullptr, "SQLiteKV is not set up");
+    return db->get_cached_statement(query);
+}
+
+Variant SQLiteKV::_read_value(sqlite3_stmt* stmt, int column) {
+    const uint8_t* data = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, column));
+    Variant value;
+    const Error err = decode_variant(value, data, sqlite3_column_bytes(stmt, column), nullptr, false);
+    ERR_FAIL_COND_V_MSG(err != OK, Variant(), "Cannot decode stored value");
+    return value;
+}
+
+bool SQLiteKV::put(const String& key, const Variant& value) {
+    sqlite3_stmt* stmt = _statement(sql_put);
+    if (stmt == nullptr) {
+        return false;
+    }
+    int length = 0;
+    ERR_FAIL_COND_V_MSG(encode_variant(value, nullptr, length, false) != OK, false, "Cannot encode value of " + key);
+    buffer.resize(length);
+    encode_variant(value, buffer.ptr(), length, false);
+
+    const CharString utf8 = key.utf8();
+    sqlite3_bind_text(stmt, 1, utf8.get_data(), utf8.length(), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 2, buffer.ptr(), length, SQLITE_STATIC);
+    const int result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    ERR_FAIL_COND_V_MSG(result != SQLITE_DONE, false,
+        "Failed to store " + key + ": " + String::utf8(sqlite3_errmsg(db->get_handle())));
+    return true;
+}
+
+Variant SQLiteKV::get_value(const String& key, const Variant& default_value) {
+    sqlite3_stmt* stmt = _statement(sql_get);
+    if (stmt == nullptr) {
+        return default_value;
+    }
+    const CharString utf8 = key.utf8();
+    sqlite3_bind_text(stmt, 1, utf8.get_data(), utf8.length(), SQLITE_STATIC);
+    const Variant value = sqlite3_step(stmt) == SQLITE_ROW ? _read_value(stmt, 0) : default_value;
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return value;
+}
+
+bool SQLiteKV::erase(const String& key) {
+    sqlite3_stmt* stmt = _statement(sql_erase);
+    if (stmt == nullptr) {
+        return false;
+    }
+    const CharString utf8 = key.utf8();
+    sqlite3_bind_text(stmt, 1, utf8.get_data(), utf8.length(), SQLITE_STATIC);
+    const int result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return result == SQLITE_DONE;
+}
+
+Dictionary SQLiteKV::get_many(const PackedStringArray& keys) {
+    Dictionary result;
+    sqlite3_stmt* stmt = _statement(sql_get);
+    if (stmt == nullptr) {
+        return result;
+    }
+    for (const String& key : keys) {
+        const CharString utf8 = key.utf8();
+        sqlite3_bind_text(stmt, 1, utf8.get_data(), utf8.length(), SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            result[key] = _read_value(stmt, 0);
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_clear_bindings(stmt);
+    return result;
+}
+
+// One transaction for all values; a savepoint, so it also nests in one the
+// caller already opened.
+bool SQLiteKV::put_many(const Dictionary& values) {
+    ERR_FAIL_COND_V_MSG(db.is_null() || db->get_handle() == nullptr, false, "SQLiteKV is not set up");
+    sqlite3* handle = db->get_handle();
+    ERR_FAIL_COND_V(sqlite3_exec(handle, "SAVEPOINT kv_put_many", nullptr, nullptr, nullptr) != SQLITE_OK, false);
+    const Array keys = values.keys();
+    for (int i = 0; i < keys.size(); ++i) {
+        if (!put(keys[i], values[keys[i]])) {
+            sqlite3_exec(handle, "ROLLBACK TO kv_put_many; RELEASE kv_put_many", nullptr, nullptr, nullptr);
+            return false;
+        }
+    }
+    return sqlite3_exec(handle, "RELEASE kv_put_many", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+Dictionary SQLiteKV::scan_prefix(const String& prefix, int limit) {
+    Dictionary result;
+    CharString lower = prefix.utf8();
+    // Keys compare bytewise, so every key with the prefix sorts below the
+    // prefix with its last byte incremented. 0xFF never occurs in UTF-8.
+    CharString upper = lower;
+    const bool bounded = upper.length() > 0;
+    if (bounded) {
+        upper.ptrw()[upper.length() - 1]++;
+    }
+    sqlite3_stmt* stmt = _statement(bounded ? sql_scan : sql_scan_all);
+    if (stmt == nullptr) {
+        return result;
+    }
+    if (bounded) {
+        sqlite3_bind_text(stmt, 1, lower.get_data(), lower.length(), SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, upper.get_data(), upper.length(), SQLITE_STATIC);
+    }
+    sqlite3_bind_int(stmt, 3, limit);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* key = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        result[SQLiteUtils::decode_utf8(key, sqlite3_column_bytes(stmt, 0))] = _read_value(stmt, 1);
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return result;
+}
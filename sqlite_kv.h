@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/templates/local_vector.h"
+#include "core/variant/dictionary.h"
+
+// String keys to Variant values in a WITHOUT ROWID table, so that saving one
+// setting writes one row instead of rewriting a whole ConfigFile or JSON
+// file. Values are stored with encode_variant() (objects are not encoded),
+// and keys sort bytewise, which makes scan_prefix() a range scan.
+class SQLiteKV : public RefCounted {
+    GDCLASS(SQLiteKV, RefCounted);
+
+    Ref<SQLiteBinding> db;
+    String sql_get;
+    String sql_put;
+    String sql_erase;
+    String sql_scan;
+    String sql_scan_all;
+    LocalVector<uint8_t> buffer;
+
+    sqlite3_stmt* _statement(const String& query);
+    static Variant _read_value(sqlite3_stmt* stmt, int column);
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteKV();
+
+    bool setup(const Ref<SQLiteBinding>& database, const String& table = "kv");
+
+    Variant get_value(const String& key, const Variant& default_value = Variant());
+    bool put(const String& key, const Variant& value);
+    bool erase(const String& key);
+    Dictionary get_many(const PackedStringArray& keys);
+    bool put_many(const Dictionary& values);
+    // Keys starting with `prefix` and their values, in key order.
+    Dictionary scan_prefix(const String& prefix, int limit = -1);
+};
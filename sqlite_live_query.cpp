@@ -0,0 +1,204 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_live_query.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+
+#include <sqlite3.h>
+
+using namespace SQLiteUtils;
+
+void SQLiteLiveQuery::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("setup", "database", "query", "arguments", "key_column"), &SQLiteLiveQuery::setup);
+    ClassDB::bind_method(D_METHOD("refresh"), &SQLiteLiveQuery::refresh);
+    ClassDB::bind_method(D_METHOD("is_dirty"), &SQLiteLiveQuery::is_dirty);
+    ClassDB::bind_method(D_METHOD("get_rows"), &SQLiteLiveQuery::get_rows);
+    ClassDB::bind_method(D_METHOD("get_tables"), &SQLiteLiveQuery::get_tables);
+
+    ADD_SIGNAL(MethodInfo("rows_added", PropertyInfo(Variant::ARRAY, "rows")));
+    ADD_SIGNAL(MethodInfo("rows_removed", PropertyInfo(Variant::ARRAY, "rows")));
+    ADD_SIGNAL(MethodInfo("rows_changed", PropertyInfo(Variant::ARRAY, "rows")));
+}
+
+SQLiteLiveQuery::SQLiteLiveQuery() = default;
+SQLiteLiveQuery::~SQLiteLiveQuery() {
+    _detach();
+}
+
+void SQLiteLiveQuery::_detach() {
+    if (db.is_valid()) {
+        db->remove_update_listener(this);
+        db.unref();
+    }
+    tables.clear();
+    rows_by_key.clear();
+    rows = Array();
+    dirty = false;
+}
+
+bool SQLiteLiveQuery::setup(const Ref<SQLiteBinding>& database, const String& p_query, const Array& p_arguments,
+        const String& p_key_column) {
+    _detach();
+    ERR_FAIL_COND_V(database.is_null() || database->get_handle() == nullptr, false);
+    ERR_FAIL_COND_V(p_key_column.is_empty(), false);
+
+    if (!database->get_read_tables(p_query, tables)) {
+        tables.clear();
+        return false;
+    }
+    // The update hook never fires for WITHOUT ROWID tables, so the query
+    // would silently go stale.
+    sqlite3_stmt* stmt = prepare(database->get_handle(), "SELECT wr FROM pragma_table_list WHERE name = ?");
+    if (stmt == nullptr) {
+        tables.clear();
+        return false;
+    }
+    for (const String& table : tables) {
+        const CharString name = table.utf8();
+        sqlite3_bind_text(stmt, 1, name.get_data(), name.length(), SQLITE_TRANSIENT);
+        const bool without_rowid = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+        sqlite3_reset(stmt);
+        if (without_rowid) {
+            sqlite3_finalize(stmt);
+            print_error("Live queries cannot watch WITHOUT ROWID table: " + table);
+            tables.clear();
+            return false;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    db = database;
+    query = p_query;
+    arguments = p_arguments;
+    key_column = p_key_column;
+    db->add_update_listener(this);
+    return refresh();
+}
+
+bool SQLiteLiveQuery::refresh() {
+    ERR_FAIL_COND_V(db.is_null(), false);
+    dirty = false;
+
+    sqlite3_stmt* stmt = prepare(db->get_handle(), query.utf8().get_data());
+    if (stmt == nullptr) {
+        return false;
+    }
+    if (!bind_args(stmt, arguments)) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    HashMap<Variant, Dictionary, VariantHasher, VariantComparator> new_rows_by_key;
+    Array new_rows;
+    Array added;
+    Array changed;
+    RowDecoder decoder(stmt);
+    bool done = false;
+    while (!done) {
+        const int result = sqlite3_step(stmt);
+        switch (result) {
+        case SQLITE_ROW:
+        {
+            const Dictionary row = decoder.fetch_row(stmt);
+            const Variant key = row.get(key_column, Variant());
+            // Rows are matched by key, so a NULL or repeated key would make
+            // them collapse into one.
+            if (key.get_type() == Variant::NIL || new_rows_by_key.has(key)) {
+                print_error("Live query key column must be unique and not NULL: " + key_column);
+                sqlite3_finalize(stmt);
+                return false;
+            }
+            new_rows.push_back(row);
+            new_rows_by_key.insert(key, row);
+
+            HashMap<Variant, Dictionary, VariantHasher, VariantComparator>::Iterator old = rows_by_key.find(key);
+            if (!old) {
+                added.push_back(row);
+            } else if (old->value != row) {
+                changed.push_back(row);
+            }
+            break;
+        }
+        case SQLITE_DONE:
+            done = true;
+            break;
+        default:
+            print_error("Unsupported step result: " + itos(result));
+            sqlite3_finalize(stmt);
+            return false;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    // Whatever is left over from the previous result is gone now.
+    Array removed;
+    for (const KeyValue<Variant, Dictionary>& E : rows_by_key) {
+        if (!new_rows_by_key.has(E.key)) {
+            removed.push_back(E.value);
+        }
+    }
+
+    rows_by_key = new_rows_by_key;
+    rows = new_rows;
+
+    if (!removed.is_empty()) {
+        emit_signal(SNAME("rows_removed"), removed);
+    }
+    if (!added.is_empty()) {
+        emit_signal(SNAME("rows_added"), added);
+    }
+    if (!changed.is_empty()) {
+        emit_signal(SNAME("rows_changed"), changed);
+    }
+    return true;
+}
+
+PackedStringArray SQLiteLiveQuery::get_tables() const {
+    PackedStringArray result;
+    for (const String& table : tables) {
+        result.push_back(table);
+    }
+    return result;
+}
+
+void SQLiteLiveQuery::_refresh_deferred() {
+    if (dirty && db.is_valid()) {
+        refresh();
+    }
+}
+
+bool SQLiteLiveQuery::watches_table(const char* table) const {
+    return tables.has(String::utf8(table));
+}
+
+void SQLiteLiveQuery::on_row_updated(int operation, const char* table, int64_t rowid) {
+    if (dirty || !tables.has(String::utf8(table))) {
+        return;
+    }
+    // SQL must not run from inside the update hook, so re-run the query once
+    // the current statement and the frame's other writes are done.
+    dirty = true;
+    callable_mp(this, &SQLiteLiveQuery::_refresh_deferred).call_deferred();
+}
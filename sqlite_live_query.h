@@ -0,0 +1,69 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/variant/array.h"
+#include "core/variant/dictionary.h"
+
+// Re-runs a SELECT when one of the tables it reads is modified through the
+// connection and emits only the rows that were added, removed or changed,
+// matched by `key_column`. The key must be unique and NOT NULL in every result,
+// and WITHOUT ROWID tables cannot be watched because they fire no update hook.
+class SQLiteLiveQuery : public RefCounted, public SQLiteUpdateListener {
+    GDCLASS(SQLiteLiveQuery, RefCounted);
+
+    Ref<SQLiteBinding> db;
+    String query;
+    Array arguments;
+    String key_column;
+
+    HashSet<String> tables;
+    HashMap<Variant, Dictionary, VariantHasher, VariantComparator> rows_by_key;
+    Array rows;
+    bool dirty = false;
+
+    void _refresh_deferred();
+    void _detach();
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteLiveQuery();
+    ~SQLiteLiveQuery();
+
+    bool setup(const Ref<SQLiteBinding>& database, const String& query, const Array& arguments,
+            const String& key_column);
+    bool refresh();
+
+    bool is_dirty() const { return dirty; }
+    Array get_rows() const { return rows; }
+    PackedStringArray get_tables() const;
+
+    bool watches_table(const char* table) const override;
+    void on_row_updated(int operation, const char* table, int64_t rowid) override;
+};
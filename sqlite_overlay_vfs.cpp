@@ -0,0 +1,495 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_overlay_vfs.h"
+#include "sqlite_utils.h"
+
+#include "core/io/file_access.h"
+#include "core/io/marshalls.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hashfuncs.h"
+#include "core/templates/local_vector.h"
+
+#include <sqlite3.h>
+
+#include <cstring>
+
+namespace SQLiteOverlayVFS {
+
+static const char* VFS_NAME = "godot_overlay";
+static const uint8_t MAGIC[8] = { 'G', 'D', 'O', 'V', 'R', 'L', 'Y', '2' };
+static const uint64_t FREE_RECORD = UINT64_MAX;
+
+enum {
+    HEADER_SIZE = 64,
+    RECORD_HEADER_SIZE = 16,
+};
+
+// Record layout, little endian: page number (u64), checksum of the page
+// number and data (u32), 4 reserved bytes, then the page data. A record is
+// written in one piece, and one whose checksum does not match, such as a
+// torn append that reads back as zeros, is treated as free on load.
+
+// Header layout, little endian:
+//   0  magic
+//   8  page size (u32)
+//   16 logical database size (u64)
+//   24 base limit: base bytes past it read as zeros after a truncate (u64)
+//   32 base file size (u64)
+//   40 base change counter, copied from the base header (u32)
+struct Overlay {
+    Ref<FileAccess> base;
+    sqlite3_file* delta = nullptr;
+
+    uint32_t page_size = 0;
+    uint64_t size = 0;
+    uint64_t base_limit = 0;
+    uint64_t base_size = 0;
+    uint32_t base_counter = 0;
+
+    // Page number to record offset in the delta.
+    HashMap<uint64_t, uint64_t> pages;
+    LocalVector<uint64_t> free_records;
+    uint64_t delta_end = HEADER_SIZE;
+    LocalVector<uint8_t> scratch;
+    LocalVector<uint8_t> record;
+};
+
+struct OverlayFile {
+    sqlite3_file base;
+    Overlay* overlay;
+};
+
+static sqlite3_vfs* default_vfs = nullptr;
+
+static int delta_read(Overlay* o, void* buffer, int amount, uint64_t offset) {
+    return o->delta->pMethods->xRead(o->delta, buffer, amount, offset);
+}
+
+static int delta_write(Overlay* o, const void* buffer, int amount, uint64_t offset) {
+    return o->delta->pMethods->xWrite(o->delta, buffer, amount, offset);
+}
+
+static int write_header(Overlay* o) {
+    uint8_t header[HEADER_SIZE] = {};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    encode_uint32(o->page_size, header + 8);
+    encode_uint64(o->size, header + 16);
+    encode_uint64(o->base_limit, header + 24);
+    encode_uint64(o->base_size, header + 32);
+    encode_uint32(o->base_counter, header + 40);
+    return delta_write(o, header, HEADER_SIZE, 0);
+}
+
+static uint64_t record_size(const Overlay* o) {
+    return RECORD_HEADER_SIZE + o->page_size;
+}
+
+static uint32_t record_checksum(uint64_t page, const uint8_t* data, uint32_t page_size) {
+    return hash_murmur3_buffer(data, page_size, hash_murmur3_one_64(page));
+}
+
+// Reads page `page` as it currently is: from the delta when it was written,
+// otherwise from the base, zero filled past the base limit.
+static int read_page(Overlay* o, uint64_t page, uint8_t* out) {
+    const uint64_t* record = o->pages.getptr(page);
+    if (record != nullptr) {
+        return delta_read(o, out, o->page_size, *record + RECORD_HEADER_SIZE);
+    }
+    memset(out, 0, o->page_size);
+    const uint64_t offset = page * o->page_size;
+    if (offset < o->base_limit) {
+        const uint64_t amount = MIN(uint64_t(o->page_size), o->base_limit - offset);
+        o->base->seek(offset);
+        if (o->base->get_buffer(out, amount) != amount) {
+            return SQLITE_IOERR_READ;
+        }
+    }
+    return SQLITE_OK;
+}
+
+static int write_page(Overlay* o, uint64_t page, const uint8_t* data) {
+    uint8_t* buffer = o->record.ptr();
+    memset(buffer, 0, RECORD_HEADER_SIZE);
+    encode_uint64(page, buffer);
+    encode_uint32(record_checksum(page, data, o->page_size), buffer + 8);
+    memcpy(buffer + RECORD_HEADER_SIZE, data, o->page_size);
+
+    uint64_t* existing = o->pages.getptr(page);
+    if (existing != nullptr) {
+        return delta_write(o, buffer, record_size(o), *existing);
+    }
+    uint64_t record = o->delta_end;
+    if (!o->free_records.is_empty()) {
+        record = o->free_records[o->free_records.size() - 1];
+        o->free_records.remove_at(o->free_records.size() - 1);
+    }
+    const int rc = delta_write(o, buffer, record_size(o), record);
+    if (rc != SQLITE_OK) {
+        o->free_records.push_back(record);
+        return rc;
+    }
+    if (record == o->delta_end) {
+        o->delta_end += record_size(o);
+    }
+    o->pages.insert(page, record);
+    return SQLITE_OK;
+}
+
+static int overlay_close(sqlite3_file* file) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    const int rc = o->delta->pMethods ? o->delta->pMethods->xClose(o->delta) : SQLITE_OK;
+    sqlite3_free(o->delta);
+    memdelete(o);
+    return rc;
+}
+
+static int overlay_read(sqlite3_file* file, void* buffer, int amount, sqlite3_int64 offset) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    uint64_t available = 0;
+    if (uint64_t(offset) < o->size) {
+        available = MIN(uint64_t(amount), o->size - offset);
+    }
+    memset(out + available, 0, amount - available);
+
+    uint64_t position = offset;
+    const uint64_t end = offset + available;
+    while (position < end) {
+        const uint64_t page = position / o->page_size;
+        const uint64_t in_page = position % o->page_size;
+        const uint64_t count = MIN(uint64_t(o->page_size) - in_page, end - position);
+        int rc;
+        if (in_page == 0 && count == o->page_size) {
+            rc = read_page(o, page, out);
+        } else {
+            rc = read_page(o, page, o->scratch.ptr());
+            memcpy(out, o->scratch.ptr() + in_page, count);
+        }
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        out += count;
+        position += count;
+    }
+    return available == uint64_t(amount) ? SQLITE_OK : SQLITE_IOERR_SHORT_READ;
+}
+
+static int overlay_write(sqlite3_file* file, const void* buffer, int amount, sqlite3_int64 offset) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    const uint8_t* in = static_cast<const uint8_t*>(buffer);
+    uint64_t position = offset;
+    const uint64_t end = offset + amount;
+    while (position < end) {
+        const uint64_t page = position / o->page_size;
+        const uint64_t in_page = position % o->page_size;
+        const uint64_t count = MIN(uint64_t(o->page_size) - in_page, end - position);
+        int rc;
+        if (in_page == 0 && count == o->page_size) {
+            rc = write_page(o, page, in);
+        } else {
+            rc = read_page(o, page, o->scratch.ptr());
+            if (rc == SQLITE_OK) {
+                memcpy(o->scratch.ptr() + in_page, in, count);
+                rc = write_page(o, page, o->scratch.ptr());
+            }
+        }
+        if (rc != SQLITE_OK) {
+            return SQLITE_IOERR_WRITE;
+        }
+        in += count;
+        position += count;
+    }
+    if (end > o->size) {
+        o->size = end;
+        return write_header(o);
+    }
+    return SQLITE_OK;
+}
+
+static int overlay_truncate(sqlite3_file* file, sqlite3_int64 size) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    if (uint64_t(size) >= o->size) {
+        return SQLITE_OK;
+    }
+    // Zero the tail of a partially kept page, so growing the file again
+    // does not bring back the old bytes.
+    const uint64_t in_page = size % o->page_size;
+    if (in_page != 0) {
+        const uint64_t page = size / o->page_size;
+        int rc = read_page(o, page, o->scratch.ptr());
+        if (rc == SQLITE_OK) {
+            memset(o->scratch.ptr() + in_page, 0, o->page_size - in_page);
+            rc = write_page(o, page, o->scratch.ptr());
+        }
+        if (rc != SQLITE_OK) {
+            return SQLITE_IOERR_TRUNCATE;
+        }
+    }
+    const uint64_t first_dropped = (size + o->page_size - 1) / o->page_size;
+    LocalVector<uint64_t> dropped;
+    for (const KeyValue<uint64_t, uint64_t>& E : o->pages) {
+        if (E.key >= first_dropped) {
+            dropped.push_back(E.key);
+        }
+    }
+    uint8_t label[RECORD_HEADER_SIZE] = {};
+    encode_uint64(FREE_RECORD, label);
+    for (uint64_t page : dropped) {
+        const uint64_t record = o->pages[page];
+        if (delta_write(o, label, RECORD_HEADER_SIZE, record) != SQLITE_OK) {
+            return SQLITE_IOERR_TRUNCATE;
+        }
+        o->pages.erase(page);
+        o->free_records.push_back(record);
+    }
+    o->size = size;
+    o->base_limit = MIN(o->base_limit, uint64_t(size));
+    return write_header(o) == SQLITE_OK ? SQLITE_OK : SQLITE_IOERR_TRUNCATE;
+}
+
+static int overlay_sync(sqlite3_file* file, int flags) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xSync(o->delta, flags);
+}
+
+static int overlay_file_size(sqlite3_file* file, sqlite3_int64* size) {
+    *size = reinterpret_cast<OverlayFile*>(file)->overlay->size;
+    return SQLITE_OK;
+}
+
+// Locks and shared memory live on the delta, which is a real file.
+static int overlay_lock(sqlite3_file* file, int lock) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xLock(o->delta, lock);
+}
+
+static int overlay_unlock(sqlite3_file* file, int lock) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xUnlock(o->delta, lock);
+}
+
+static int overlay_check_reserved_lock(sqlite3_file* file, int* result) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xCheckReservedLock(o->delta, result);
+}
+
+static int overlay_file_control(sqlite3_file* file, int op, void* arg) {
+    // Size hints and chunk sizes would resize the delta, which does not
+    // share offsets with the database.
+    return SQLITE_NOTFOUND;
+}
+
+static int overlay_sector_size(sqlite3_file* file) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xSectorSize(o->delta);
+}
+
+static int overlay_device_characteristics(sqlite3_file* file) {
+    return 0;
+}
+
+static int overlay_shm_map(sqlite3_file* file, int region, int size, int extend, void volatile** memory) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xShmMap(o->delta, region, size, extend, memory);
+}
+
+static int overlay_shm_lock(sqlite3_file* file, int offset, int count, int flags) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xShmLock(o->delta, offset, count, flags);
+}
+
+static void overlay_shm_barrier(sqlite3_file* file) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    o->delta->pMethods->xShmBarrier(o->delta);
+}
+
+static int overlay_shm_unmap(sqlite3_file* file, int delete_flag) {
+    Overlay* o = reinterpret_cast<OverlayFile*>(file)->overlay;
+    return o->delta->pMethods->xShmUnmap(o->delta, delete_flag);
+}
+
+// Version 2: no xFetch, since memory mapping the delta would expose records
+// instead of pages.
+static const sqlite3_io_methods overlay_methods = {
+    2,
+    overlay_close,
+    overlay_read,
+    overlay_write,
+    overlay_truncate,
+    overlay_sync,
+    overlay_file_size,
+    overlay_lock,
+    overlay_unlock,
+    overlay_check_reserved_lock,
+    overlay_file_control,
+    overlay_sector_size,
+    overlay_device_characteristics,
+    overlay_shm_map,
+    overlay_shm_lock,
+    overlay_shm_barrier,
+    overlay_shm_unmap,
+    nullptr,
+    nullptr,
+};
+
+static uint32_t base_page_size(const uint8_t* header) {
+    const uint32_t size = (uint32_t(header[16]) << 8) | header[17];
+    if (size == 1) {
+        return 65536;
+    }
+    if (size < 512 || size > 32768 || (size & (size - 1)) != 0) {
+        return 4096;
+    }
+    return size;
+}
+
+static uint32_t base_change_counter(const uint8_t* header) {
+    return (uint32_t(header[24]) << 24) | (uint32_t(header[25]) << 16) | (uint32_t(header[26]) << 8) | header[27];
+}
+
+// Reads the delta header and indexes its records, or writes a new header
+// when the delta is empty.
+static int load_delta(Overlay* o) {
+    uint8_t base_header[100] = {};
+    o->base_size = o->base->get_length();
+    o->base->seek(0);
+    o->base->get_buffer(base_header, sizeof(base_header));
+    const uint32_t counter = base_change_counter(base_header);
+
+    sqlite3_int64 delta_size = 0;
+    int rc = o->delta->pMethods->xFileSize(o->delta, &delta_size);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    if (delta_size < HEADER_SIZE) {
+        o->page_size = base_page_size(base_header);
+        o->size = o->base_size;
+        o->base_limit = o->base_size;
+        o->base_counter = counter;
+        o->scratch.resize(o->page_size);
+        o->record.resize(record_size(o));
+        return write_header(o);
+    }
+
+    uint8_t header[HEADER_SIZE];
+    rc = delta_read(o, header, HEADER_SIZE, 0);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0) {
+        sqlite3_log(SQLITE_CANTOPEN, "overlay delta has no overlay header");
+        return SQLITE_CANTOPEN;
+    }
+    o->page_size = decode_uint32(header + 8);
+    o->size = decode_uint64(header + 16);
+    o->base_limit = decode_uint64(header + 24);
+    if (decode_uint64(header + 32) != o->base_size || decode_uint32(header + 40) != counter) {
+        sqlite3_log(SQLITE_CANTOPEN, "overlay delta was made for a different base file");
+        return SQLITE_CANTOPEN;
+    }
+    o->base_counter = counter;
+    o->scratch.resize(o->page_size);
+    o->record.resize(record_size(o));
+
+    // A torn record at the end is ignored and later overwritten; one torn in
+    // place fails its checksum and is reused.
+    uint64_t record = HEADER_SIZE;
+    while (record + record_size(o) <= uint64_t(delta_size)) {
+        rc = delta_read(o, o->record.ptr(), record_size(o), record);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+        const uint64_t page = decode_uint64(o->record.ptr());
+        const bool intact = decode_uint32(o->record.ptr() + 8) ==
+                record_checksum(page, o->record.ptr() + RECORD_HEADER_SIZE, o->page_size);
+        if (page == FREE_RECORD || !intact || page * o->page_size >= o->size) {
+            o->free_records.push_back(record);
+        } else {
+            o->pages.insert(page, record);
+        }
+        record += record_size(o);
+    }
+    o->delta_end = record;
+    return SQLITE_OK;
+}
+
+static int overlay_open(sqlite3_vfs* vfs, sqlite3_filename name, sqlite3_file* file, int flags, int* out_flags) {
+    if (!(flags & SQLITE_OPEN_MAIN_DB) || name == nullptr) {
+        // szOsFile is at least the default VFS's, so its files fit in place.
+        return default_vfs->xOpen(default_vfs, name, file, flags, out_flags);
+    }
+    file->pMethods = nullptr;
+    const char* base_path = sqlite3_uri_parameter(name, "base");
+    if (base_path == nullptr) {
+        sqlite3_log(SQLITE_CANTOPEN, "overlay database opened without a base parameter");
+        return SQLITE_CANTOPEN;
+    }
+
+    Overlay* o = memnew(Overlay);
+    o->base = FileAccess::open(String::utf8(base_path), FileAccess::READ);
+    o->delta = static_cast<sqlite3_file*>(sqlite3_malloc(default_vfs->szOsFile));
+    if (o->base.is_null() || o->delta == nullptr) {
+        sqlite3_free(o->delta);
+        memdelete(o);
+        return SQLITE_CANTOPEN;
+    }
+    memset(o->delta, 0, default_vfs->szOsFile);
+    int rc = default_vfs->xOpen(default_vfs, name, o->delta, flags, out_flags);
+    if (rc == SQLITE_OK) {
+        rc = load_delta(o);
+    }
+    if (rc != SQLITE_OK) {
+        if (o->delta->pMethods) {
+            o->delta->pMethods->xClose(o->delta);
+        }
+        sqlite3_free(o->delta);
+        memdelete(o);
+        return rc;
+    }
+    reinterpret_cast<OverlayFile*>(file)->overlay = o;
+    file->pMethods = &overlay_methods;
+    return SQLITE_OK;
+}
+
+const char* get_name() {
+    static sqlite3_vfs vfs;
+    static Mutex mutex;
+    MutexLock lock(mutex);
+    if (default_vfs == nullptr) {
+        default_vfs = sqlite3_vfs_find(nullptr);
+        vfs = *default_vfs;
+        vfs.zName = VFS_NAME;
+        vfs.pNext = nullptr;
+        vfs.szOsFile = MAX(default_vfs->szOsFile, int(sizeof(OverlayFile)));
+        vfs.xOpen = overlay_open;
+        sqlite3_vfs_register(&vfs, 0);
+    }
+    return VFS_NAME;
+}
+
+String make_uri(const String& delta_path, const String& base_path) {
+    return SQLiteUtils::file_uri(delta_path) + "?base=" + base_path.uri_encode();
+}
+
+}
@@ -0,0 +1,48 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/string/ustring.h"
+
+// A VFS that opens a database as a read-only base file plus a writable delta
+// file. The base is read through FileAccess, so it can live in res:// or a
+// PCK; every page written goes to the delta, which holds only the pages that
+// differ from the base. Journals, WAL and temporary files use the default VFS.
+//
+// The delta starts with a small header followed by records of one page each
+// (an 8 byte page number and the page data). Pages past the end of a
+// truncated database are freed and their records reused.
+//
+// The record index is built once at open, so a delta must only be used by
+// one connection at a time; SQLiteBinding::open_overlay() holds an exclusive
+// lock on it until close.
+namespace SQLiteOverlayVFS {
+
+// Registers the VFS on first use and returns its name.
+const char* get_name();
+// Builds the URI to pass to sqlite3_open_v2() with SQLITE_OPEN_URI.
+// `delta_path` must be an absolute file system path; `base_path` may be any
+// path FileAccess can open.
+String make_uri(const String& delta_path, const String& base_path);
+
+}
@@ -0,0 +1,200 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_row_set.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+
+#include <sqlite3.h>
+
+void SQLiteRowSet::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_row_count"), &SQLiteRowSet::get_row_count);
+    ClassDB::bind_method(D_METHOD("get_column_count"), &SQLiteRowSet::get_column_count);
+    ClassDB::bind_method(D_METHOD("get_column_names"), &SQLiteRowSet::get_column_names);
+    ClassDB::bind_method(D_METHOD("get_column_index", "name"), &SQLiteRowSet::get_column_index);
+    ClassDB::bind_method(D_METHOD("get_value", "row", "column"), &SQLiteRowSet::get_value);
+    ClassDB::bind_method(D_METHOD("get_row", "row"), &SQLiteRowSet::get_row);
+    ClassDB::bind_method(D_METHOD("get_row_dictionary", "row"), &SQLiteRowSet::get_row_dictionary);
+}
+
+void SQLiteRowSet::set_columns(sqlite3_stmt* stmt) {
+    const int column_count = sqlite3_column_count(stmt);
+    column_names.resize(column_count);
+    column_indices.clear();
+    for (int i = 0; i < column_count; ++i) {
+        const String name = String::utf8(sqlite3_column_name(stmt, i));
+        column_names.set(i, name);
+        // Like fetch_row(), a repeated name refers to the last such column.
+        column_indices[name] = i;
+    }
+}
+
+void SQLiteRowSet::append_row(sqlite3_stmt* stmt) {
+    const int column_count = column_names.size();
+    const uint32_t first = cells.size();
+    cells.resize(first + column_count);
+    for (int i = 0; i < column_count; ++i) {
+        Cell& cell = cells[first + i];
+        cell.type = uint8_t(sqlite3_column_type(stmt, i));
+        switch (cell.type) {
+        case SQLITE_INTEGER:
+            cell.integer = sqlite3_column_int64(stmt, i);
+            break;
+        case SQLITE_FLOAT:
+            cell.real = sqlite3_column_double(stmt, i);
+            break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+        {
+            const void* data = cell.type == SQLITE_TEXT ? static_cast<const void*>(sqlite3_column_text(stmt, i))
+                                                        : sqlite3_column_blob(stmt, i);
+            const uint32_t size = sqlite3_column_bytes(stmt, i);
+            const uint32_t offset = arena.size();
+            if (uint64_t(offset) + size > UINT32_MAX) {
+                print_error("Row set is larger than 4 GiB, value left out");
+                cell.type = SQLITE_NULL;
+                break;
+            }
+            arena.resize(offset + size);
+            if (size > 0) {
+                memcpy(arena.ptr() + offset, data, size);
+            }
+            cell.bytes.offset = offset;
+            cell.bytes.size = size;
+            break;
+        }
+        default:
+            cell.type = SQLITE_NULL;
+            break;
+        }
+    }
+    row_count++;
+}
+
+int SQLiteRowSet::get_column_index(const String& name) const {
+    const int* index = column_indices.getptr(name);
+    return index != nullptr ? *index : -1;
+}
+
+Variant SQLiteRowSet::get_cell(int row, int column) const {
+    ERR_FAIL_INDEX_V(row, row_count, Variant());
+    ERR_FAIL_INDEX_V(column, column_names.size(), Variant());
+    const Cell& cell = cells[uint32_t(row) * column_names.size() + column];
+    switch (cell.type) {
+    case SQLITE_INTEGER:
+        return cell.integer;
+    case SQLITE_FLOAT:
+        return cell.real;
+    case SQLITE_TEXT:
+        return SQLiteUtils::decode_utf8(reinterpret_cast<const char*>(arena.ptr() + cell.bytes.offset), cell.bytes.size);
+    case SQLITE_BLOB:
+    {
+        const uint8_t* data = arena.ptr() + cell.bytes.offset;
+        PackedByteArray blob;
+        if (SQLiteUtils::decompress_blob(data, cell.bytes.size, blob)) {
+            return blob;
+        }
+        blob.resize(cell.bytes.size);
+        if (cell.bytes.size > 0) {
+            memcpy(blob.ptrw(), data, cell.bytes.size);
+        }
+        return blob;
+    }
+    default:
+        return Variant();
+    }
+}
+
+Variant SQLiteRowSet::get_value(int row, const Variant& column) const {
+    if (column.get_type() == Variant::INT) {
+        return get_cell(row, column);
+    }
+    const int index = get_column_index(column);
+    if (index < 0) {
+        return Variant();
+    }
+    return get_cell(row, index);
+}
+
+Ref<SQLiteRow> SQLiteRowSet::get_row(int row) {
+    ERR_FAIL_INDEX_V(row, row_count, Ref<SQLiteRow>());
+    Ref<SQLiteRow> result;
+    result.instantiate();
+    result->set_row(this, row);
+    return result;
+}
+
+// Same shape as a query_fetch_rows() row: NULL columns are left out.
+Dictionary SQLiteRowSet::get_row_dictionary(int row) const {
+    ERR_FAIL_INDEX_V(row, row_count, Dictionary());
+    Dictionary result;
+    for (int i = 0; i < column_names.size(); ++i) {
+        if (cells[uint32_t(row) * column_names.size() + i].type != SQLITE_NULL) {
+            result[column_names[i]] = get_cell(row, i);
+        }
+    }
+    return result;
+}
+
+void SQLiteRow::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_index"), &SQLiteRow::get_index);
+    ClassDB::bind_method(D_METHOD("get_value", "column"), &SQLiteRow::get_value);
+    ClassDB::bind_method(D_METHOD("to_dictionary"), &SQLiteRow::to_dictionary);
+}
+
+bool SQLiteRow::_get(const StringName& name, Variant& r_ret) const {
+    if (row_set.is_null()) {
+        return false;
+    }
+    const int column = row_set->get_column_index(name);
+    if (column < 0) {
+        return false;
+    }
+    r_ret = row_set->get_cell(index, column);
+    return true;
+}
+
+void SQLiteRow::_get_property_list(List<PropertyInfo>* list) const {
+    if (row_set.is_null()) {
+        return;
+    }
+    for (const String& name : row_set->get_column_names()) {
+        list->push_back(PropertyInfo(Variant::NIL, name, PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NIL_IS_VARIANT));
+    }
+}
+
+void SQLiteRow::set_row(const Ref<SQLiteRowSet>& rows, int row) {
+    row_set = rows;
+    index = row;
+}
+
+Variant SQLiteRow::get_value(const Variant& column) const {
+    ERR_FAIL_COND_V(row_set.is_null(), Variant());
+    return row_set->get_value(index, column);
+}
+
+Dictionary SQLiteRow::to_dictionary() const {
+    ERR_FAIL_COND_V(row_set.is_null(), Dictionary());
+    return row_set->get_row_dictionary(index);
+}
@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+class SQLiteRow;
+struct sqlite3_stmt;
+
+// The result of SQLiteBinding.query_fetch_row_set(). Column values are kept
+// as SQLite returned them, strings and blobs in one byte arena per query,
+// and only become Variants when read, so wide rows cost little when most
+// of their columns are never looked at.
+class SQLiteRowSet : public RefCounted {
+    GDCLASS(SQLiteRowSet, RefCounted);
+
+    struct Cell {
+        union {
+            int64_t integer;
+            double real;
+            struct {
+                uint32_t offset;
+                uint32_t size;
+            } bytes;
+        };
+        uint8_t type;
+    };
+
+    PackedStringArray column_names;
+    HashMap<String, int> column_indices;
+    LocalVector<Cell> cells;
+    LocalVector<uint8_t> arena;
+    int row_count = 0;
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteRowSet() = default;
+
+    // Takes the columns of `stmt`, then copies its current row on each call
+    // to append_row().
+    void set_columns(sqlite3_stmt* stmt);
+    void append_row(sqlite3_stmt* stmt);
+
+    int get_row_count() const { return row_count; }
+    int get_column_count() const { return column_names.size(); }
+    PackedStringArray get_column_names() const { return column_names; }
+    // -1 when there is no such column.
+    int get_column_index(const String& name) const;
+
+    // `column` is an index or a column name. NULL and unknown columns give
+    // an empty Variant.
+    Variant get_value(int row, const Variant& column) const;
+    Variant get_cell(int row, int column) const;
+    Ref<SQLiteRow> get_row(int row);
+    Dictionary get_row_dictionary(int row) const;
+};
+
+// One row of an SQLiteRowSet. Columns read as properties, so `row.name`
+// and `row.get("name")` both decode just that column.
+class SQLiteRow : public RefCounted {
+    GDCLASS(SQLiteRow, RefCounted);
+
+    Ref<SQLiteRowSet> row_set;
+    int index = 0;
+
+protected:
+    static void _bind_methods();
+    bool _get(const StringName& name, Variant& r_ret) const;
+    void _get_property_list(List<PropertyInfo>* list) const;
+
+public:
+    SQLiteRow() = default;
+
+    void set_row(const Ref<SQLiteRowSet>& rows, int row);
+    int get_index() const { return index; }
+    Variant get_value(const Variant& column) const;
+    Dictionary to_dictionary() const;
+};
@@ -0,0 +1,254 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_shard_set.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/sort_array.h"
+#include "sqlite_utils.h"
+
+#include <sqlite3.h>
+
+using namespace SQLiteUtils;
+
+struct SQLiteShardSet::QueryTask {
+    CharString query;
+    Array arguments;
+    bool fetch = false;
+    LocalVector<Array> results;
+    SafeFlag failed;
+};
+
+namespace {
+
+bool variant_less(const Variant& a, const Variant& b) {
+    bool valid = false;
+    Variant result;
+    Variant::evaluate(Variant::OP_LESS, a, b, result, valid);
+    if (!valid) {
+        // Incomparable values (e.g. NULL against a number) order by type.
+        return a.get_type() < b.get_type();
+    }
+    return result;
+}
+
+struct RowComparator {
+    Variant column;
+    bool descending = false;
+
+    bool operator()(const Dictionary& a, const Dictionary& b) const {
+        const Variant lhs = a.get(column, Variant());
+        const Variant rhs = b.get(column, Variant());
+        return descending ? variant_less(rhs, lhs) : variant_less(lhs, rhs);
+    }
+};
+
+}
+
+void SQLiteShardSet::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_paths", "paths"), &SQLiteShardSet::set_paths);
+    ClassDB::bind_method(D_METHOD("get_paths"), &SQLiteShardSet::get_paths);
+    ClassDB::bind_method(D_METHOD("get_shard_count"), &SQLiteShardSet::get_shard_count);
+    ClassDB::bind_method(D_METHOD("query", "query", "arguments", "options"), &SQLiteShardSet::query, DEFVAL(Dictionary()));
+    ClassDB::bind_method(D_METHOD("execute", "query", "arguments"), &SQLiteShardSet::execute);
+    ClassDB::bind_method(D_METHOD("close"), &SQLiteShardSet::close);
+
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "paths"), "set_paths", "get_paths");
+}
+
+SQLiteShardSet::SQLiteShardSet() = default;
+SQLiteShardSet::~SQLiteShardSet() {
+    close();
+}
+
+void SQLiteShardSet::set_paths(const PackedStringArray& p_paths) {
+    close();
+    paths = p_paths;
+    shards.resize(paths.size());
+    for (uint32_t i = 0; i < shards.size(); ++i) {
+        shards[i].instantiate();
+    }
+}
+
+void SQLiteShardSet::close() {
+    for (Ref<SQLiteBinding>& shard : shards) {
+        if (shard.is_valid() && shard->get_handle() != nullptr) {
+            shard->close();
+        }
+    }
+    shards.clear();
+}
+
+void SQLiteShardSet::_run_shard(uint32_t index, QueryTask* task) {
+    const Ref<SQLiteBinding>& shard = shards[index];
+    if (shard->get_handle() == nullptr && !shard->open(paths[index])) {
+        task->failed.set();
+        return;
+    }
+    // Stepped here rather than through SQLiteBinding, whose fetch functions
+    // cannot tell an error from an empty result.
+    sqlite3* db = shard->get_handle();
+    sqlite3_stmt* stmt = prepare(db, task->query.get_data());
+    if (stmt == nullptr || !bind_args(stmt, task->arguments)) {
+        sqlite3_finalize(stmt);
+        task->failed.set();
+        return;
+    }
+    RowDecoder decoder(stmt);
+    Array& rows = task->results[index];
+    int result = sqlite3_step(stmt);
+    for (; result == SQLITE_ROW; result = sqlite3_step(stmt)) {
+        if (task->fetch) {
+            rows.push_back(decoder.fetch_row(stmt));
+        }
+    }
+    if (result != SQLITE_DONE) {
+        print_error("Query failed on " + paths[index] + ": " + String::utf8(sqlite3_errmsg(db)));
+        task->failed.set();
+    }
+    sqlite3_finalize(stmt);
+}
+
+String SQLiteShardSet::_push_down(const String& query, const Dictionary& options) {
+    const String order_by = options.get("order_by", String());
+    const int limit = options.get("limit", -1);
+    if (limit < 0 || !Dictionary(options.get("aggregates", Dictionary())).is_empty()) {
+        // Every shard has to return all of its rows anyway.
+        return query;
+    }
+    String sql = "SELECT * FROM (" + query.strip_edges().trim_suffix(";") + ")";
+    if (!order_by.is_empty()) {
+        sql += " ORDER BY " + quote_identifier(order_by) + (bool(options.get("descending", false)) ? " DESC" : "");
+    }
+    return sql + " LIMIT " + itos(limit);
+}
+
+Array SQLiteShardSet::_merge_aggregates(const LocalVector<Array>& results, const Dictionary& aggregates,
+        const String& group_by) {
+    HashMap<Variant, int, VariantHasher, VariantComparator> group_index;
+    Array merged;
+    const Array columns = aggregates.keys();
+    for (const Array& rows : results) {
+        for (int r = 0; r < rows.size(); ++r) {
+            const Dictionary row = rows[r];
+            const Variant group = group_by.is_empty() ? Variant() : row.get(group_by, Variant());
+            HashMap<Variant, int, VariantHasher, VariantComparator>::Iterator existing = group_index.find(group);
+            if (!existing) {
+                group_index.insert(group, merged.size());
+                merged.push_back(row.duplicate());
+                continue;
+            }
+
+            Dictionary accumulated = merged[existing->value];
+            for (int c = 0; c < columns.size(); ++c) {
+                const Variant& column = columns[c];
+                if (!row.has(column)) {
+                    continue;
+                }
+                const Variant value = row[column];
+                if (!accumulated.has(column)) {
+                    accumulated[column] = value;
+                    continue;
+                }
+                const Variant current = accumulated[column];
+                const String function = String(aggregates[column]).to_lower();
+                if (function == "sum" || function == "count") {
+                    accumulated[column] = Variant::evaluate(Variant::OP_ADD, current, value);
+                } else if (function == "min") {
+                    if (variant_less(value, current)) {
+                        accumulated[column] = value;
+                    }
+                } else if (function == "max") {
+                    if (variant_less(current, value)) {
+                        accumulated[column] = value;
+                    }
+                } else {
+                    ERR_FAIL_V_MSG(Array(), "Unsupported aggregate: " + function);
+                }
+            }
+        }
+    }
+    return merged;
+}
+
+Array SQLiteShardSet::query(const String& query, const Array& arguments, const Dictionary& options) {
+    ERR_FAIL_COND_V_MSG(shards.is_empty(), Array(), "No shards configured");
+
+    QueryTask task;
+    task.query = _push_down(query, options).utf8();
+    task.arguments = arguments;
+    task.fetch = true;
+    task.results.resize(shards.size());
+    WorkerThreadPool::GroupID group = WorkerThreadPool::get_singleton()->add_template_group_task(
+        this, &SQLiteShardSet::_run_shard, &task, shards.size(), -1, true, String("SQLiteShardSet query"));
+    WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group);
+    ERR_FAIL_COND_V_MSG(task.failed.is_set(), Array(), "Query failed on one or more shards");
+
+    const Dictionary aggregates = options.get("aggregates", Dictionary());
+    Array merged;
+    if (!aggregates.is_empty()) {
+        merged = _merge_aggregates(task.results, aggregates, options.get("group_by", String()));
+    } else {
+        for (const Array& rows : task.results) {
+            merged.append_array(rows);
+        }
+    }
+
+    const String order_by = options.get("order_by", String());
+    if (!order_by.is_empty()) {
+        LocalVector<Dictionary> rows;
+        rows.resize(merged.size());
+        for (int i = 0; i < merged.size(); ++i) {
+            rows[i] = merged[i];
+        }
+        SortArray<Dictionary, RowComparator> sorter;
+        sorter.compare.column = order_by;
+        sorter.compare.descending = options.get("descending", false);
+        sorter.sort(rows.ptr(), rows.size());
+        for (int i = 0; i < merged.size(); ++i) {
+            merged[i] = rows[i];
+        }
+    }
+
+    const int limit = options.get("limit", -1);
+    if (limit >= 0 && merged.size() > limit) {
+        merged.resize(limit);
+    }
+    return merged;
+}
+
+bool SQLiteShardSet::execute(const String& query, const Array& arguments) {
+    ERR_FAIL_COND_V_MSG(shards.is_empty(), false, "No shards configured");
+
+    QueryTask task;
+    task.query = query.utf8();
+    task.arguments = arguments;
+    task.results.resize(shards.size());
+    WorkerThreadPool::GroupID group = WorkerThreadPool::get_singleton()->add_template_group_task(
+        this, &SQLiteShardSet::_run_shard, &task, shards.size(), -1, true, String("SQLiteShardSet execute"));
+    WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group);
+    return !task.failed.is_set();
+}
@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/templates/local_vector.h"
+#include "core/variant/array.h"
+#include "core/variant/dictionary.h"
+
+// Runs one query against many database files in parallel on the
+// WorkerThreadPool and merges the per-shard results. Each shard has its own
+// connection, opened on first use.
+//
+// Options understood by query():
+//   "order_by"   - column to sort the merged rows by
+//   "descending" - sort in descending order
+//   "limit"      - maximum number of merged rows
+//   "aggregates" - Dictionary of column -> "sum", "count", "min" or "max";
+//                  rows are combined into one per "group_by" value
+//   "group_by"   - column the aggregated rows are grouped by
+// Without aggregates, "order_by" and "limit" are pushed down as well: each
+// shard runs `SELECT * FROM (query) ORDER BY ... LIMIT ...`, so it returns
+// only its best rows. The query must then be a single SELECT.
+// If any shard fails to open, prepare or step, query() returns an empty
+// Array and execute() false.
+class SQLiteShardSet : public RefCounted {
+    GDCLASS(SQLiteShardSet, RefCounted);
+
+    struct QueryTask;
+
+    PackedStringArray paths;
+    LocalVector<Ref<SQLiteBinding>> shards;
+
+    void _run_shard(uint32_t index, QueryTask* task);
+    static String _push_down(const String& query, const Dictionary& options);
+    static Array _merge_aggregates(const LocalVector<Array>& results, const Dictionary& aggregates,
+            const String& group_by);
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteShardSet();
+    ~SQLiteShardSet();
+
+    void set_paths(const PackedStringArray& paths);
+    PackedStringArray get_paths() const { return paths; }
+    int get_shard_count() const { return shards.size(); }
+
+    Array query(const String& query, const Array& arguments, const Dictionary& options = Dictionary());
+    bool execute(const String& query, const Array& arguments);
+    void close();
+};
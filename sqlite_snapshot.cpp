@@ -0,0 +1,48 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_snapshot.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+
+#include <sqlite3.h>
+
+void SQLiteSnapshot::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("compare", "other"), &SQLiteSnapshot::compare);
+}
+
+SQLiteSnapshot::~SQLiteSnapshot() {
+    set_handle(nullptr);
+}
+
+void SQLiteSnapshot::set_handle(sqlite3_snapshot* handle) {
+    if (snapshot != nullptr) {
+        sqlite3_snapshot_free(snapshot);
+    }
+    snapshot = handle;
+}
+
+int SQLiteSnapshot::compare(const Ref<SQLiteSnapshot>& other) const {
+    ERR_FAIL_COND_V(snapshot == nullptr || other.is_null() || other->snapshot == nullptr, 0);
+    return sqlite3_snapshot_cmp(snapshot, other->snapshot);
+}
@@ -0,0 +1,49 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/object/ref_counted.h"
+
+struct sqlite3_snapshot;
+
+// A database version of a WAL mode database, taken with
+// SQLiteBinding.snapshot_get() and read from any number of connections to
+// the same file with SQLiteBinding.snapshot_open() until snapshot_close().
+class SQLiteSnapshot : public RefCounted {
+    GDCLASS(SQLiteSnapshot, RefCounted);
+
+    sqlite3_snapshot* snapshot = nullptr;
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteSnapshot() = default;
+    ~SQLiteSnapshot();
+
+    void set_handle(sqlite3_snapshot* handle);
+    sqlite3_snapshot* get_handle() const { return snapshot; }
+
+    // Negative when this version is older than `other`, positive when newer.
+    int compare(const Ref<SQLiteSnapshot>& other) const;
+};
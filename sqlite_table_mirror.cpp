@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_table_mirror.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+
+#include <sqlite3.h>
+
+using namespace SQLiteUtils;
+
+SQLiteTableMirror::SQLiteTableMirror(sqlite3* p_db, const String& p_table, const String& p_key_column) :
+        db(p_db), table(p_table), table_utf8(p_table.utf8()), key_column(p_key_column) {
+}
+
+SQLiteTableMirror::~SQLiteTableMirror() {
+    sqlite3_finalize(select_row);
+}
+
+// Rows are selected as `_rowid_, *`; column 0 is the rowid.
+void SQLiteTableMirror::_store(sqlite3_stmt* stmt) {
+    const int64_t rowid = sqlite3_column_int64(stmt, 0);
+    Dictionary row;
+    for (uint32_t i = 1; i < column_names.size(); ++i) {
+        if (sqlite3_column_type(stmt, i) != SQLITE_NULL) {
+            row[column_names[i]] = column_value(stmt, i);
+        }
+    }
+    _remove(rowid);
+    const Variant key = column_value(stmt, key_index);
+    // INSERT OR REPLACE deletes the row holding the key under another rowid
+    // without calling the update hook.
+    const int64_t* previous = rowids_by_key.getptr(key);
+    if (previous != nullptr) {
+        keys_by_rowid.erase(*previous);
+    }
+    rows.insert(key, row);
+    keys_by_rowid.insert(rowid, key);
+    rowids_by_key.insert(key, rowid);
+}
+
+void SQLiteTableMirror::_remove(int64_t rowid) {
+    HashMap<int64_t, Variant>::Iterator key = keys_by_rowid.find(rowid);
+    if (key) {
+        rows.erase(key->value);
+        rowids_by_key.erase(key->value);
+        keys_by_rowid.erase(rowid);
+    }
+}
+
+bool SQLiteTableMirror::load() {
+    const String columns = "SELECT _rowid_, * FROM " + quote_identifier(table);
+    sqlite3_stmt* stmt = prepare(db, columns.utf8().get_data());
+    ERR_FAIL_NULL_V_MSG(stmt, false, "Cannot mirror " + table + " (WITHOUT ROWID tables are not supported)");
+    column_names.clear();
+    key_index = -1;
+    for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+        const char* name = sqlite3_column_name(stmt, i);
+        const String column = String::utf8(name);
+        column_names.push_back(column);
+        if (i == 0) {
+            continue;
+        }
+        // A column with one of these names hides the real rowid.
+        if (sqlite3_stricmp(name, "rowid") == 0 || sqlite3_stricmp(name, "_rowid_") == 0 ||
+                sqlite3_stricmp(name, "oid") == 0) {
+            sqlite3_finalize(stmt);
+            ERR_FAIL_V_MSG(false, "Cannot mirror " + table + ": column " + column + " shadows the rowid");
+        }
+        if (column == key_column) {
+            key_index = i;
+        }
+    }
+    if (key_index < 0) {
+        sqlite3_finalize(stmt);
+        ERR_FAIL_V_MSG(false, "Table " + table + " has no column " + key_column);
+    }
+
+    // REPLACE on any other unique constraint would delete a row without
+    // calling the update hook, leaving it in the mirror.
+    sqlite3_stmt* unique = prepare(db,
+            "SELECT l.name FROM pragma_index_list(?1) AS l WHERE l.\"unique\" AND "
+            "((SELECT count(*) FROM pragma_index_info(l.name)) != 1 OR "
+            "(SELECT name FROM pragma_index_info(l.name)) IS NOT ?2)");
+    if (unique == nullptr) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    const CharString key_utf8 = key_column.utf8();
+    sqlite3_bind_text(unique, 1, table_utf8.get_data(), table_utf8.length(), SQLITE_STATIC);
+    sqlite3_bind_text(unique, 2, key_utf8.get_data(), key_utf8.length(), SQLITE_STATIC);
+    const bool other_unique = sqlite3_step(unique) == SQLITE_ROW;
+    sqlite3_finalize(unique);
+    if (other_unique) {
+        sqlite3_finalize(stmt);
+        ERR_FAIL_V_MSG(false, "Cannot mirror " + table + ": it has unique constraints besides " + key_column);
+    }
+
+    rows.clear();
+    keys_by_rowid.clear();
+    rowids_by_key.clear();
+    pending.clear();
+    in_transaction.clear();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        _store(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_finalize(select_row);
+    select_row = prepare(db, (columns + " WHERE _rowid_ = ?").utf8().get_data());
+    return select_row != nullptr;
+}
+
+void SQLiteTableMirror::sync() {
+    if (sqlite3_get_autocommit(db)) {
+        // Whatever was read in the last transaction has been committed.
+        in_transaction.clear();
+    }
+    if (pending.is_empty()) {
+        return;
+    }
+    for (const int64_t rowid : pending) {
+        sqlite3_bind_int64(select_row, 1, rowid);
+        if (sqlite3_step(select_row) == SQLITE_ROW) {
+            _store(select_row);
+        } else {
+            _remove(rowid);
+        }
+        sqlite3_reset(select_row);
+        if (!sqlite3_get_autocommit(db)) {
+            in_transaction.insert(rowid);
+        }
+    }
+    pending.clear();
+}
+
+void SQLiteTableMirror::on_row_updated(int operation, const char* p_table, int64_t rowid) {
+    if (sqlite3_stricmp(table_utf8.get_data(), p_table) == 0) {
+        pending.insert(rowid);
+    }
+}
+
+bool SQLiteTableMirror::watches_table(const char* p_table) const {
+    return sqlite3_stricmp(table_utf8.get_data(), p_table) == 0;
+}
+
+void SQLiteTableMirror::on_rollback() {
+    for (const int64_t rowid : in_transaction) {
+        pending.insert(rowid);
+    }
+    in_transaction.clear();
+}
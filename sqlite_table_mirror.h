@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/variant/dictionary.h"
+
+// All rows of one rowid table, held in a HashMap by a unique key column.
+// Tables with unique constraints besides the key are rejected, because
+// INSERT OR REPLACE deletes rows on those without calling the update hook,
+// and so are tables with a column named rowid, _rowid_ or oid.
+// Row changes made through the connection mark their rowids, including
+// DELETE without WHERE, which deletes row by row while the table is
+// mirrored. Marked rows are read again on the next lookup, and ROLLBACK or
+// ROLLBACK TO marks again the rows read inside the transaction. Changes made
+// by other connections are not seen.
+class SQLiteTableMirror : public SQLiteUpdateListener {
+    sqlite3* db = nullptr;
+    String table;
+    CharString table_utf8;
+    String key_column;
+    int key_index = -1;
+    LocalVector<Variant> column_names;
+
+    HashMap<Variant, Dictionary, VariantHasher, VariantComparator> rows;
+    HashMap<int64_t, Variant> keys_by_rowid;
+    HashMap<Variant, int64_t, VariantHasher, VariantComparator> rowids_by_key;
+    HashSet<int64_t> pending;
+    // Re-read inside the current transaction, to mark again on rollback.
+    HashSet<int64_t> in_transaction;
+    sqlite3_stmt* select_row = nullptr;
+
+    void _store(sqlite3_stmt* stmt);
+    void _remove(int64_t rowid);
+
+public:
+    SQLiteTableMirror(sqlite3* db, const String& table, const String& key_column);
+    ~SQLiteTableMirror();
+
+    bool load();
+    // Re-reads the rows changed since the last call.
+    void sync();
+    [[nodiscard]] const Dictionary* get(const Variant& key) const { return rows.getptr(key); }
+    [[nodiscard]] int size() const { return rows.size(); }
+
+    void on_row_updated(int operation, const char* table, int64_t rowid) override;
+    bool watches_table(const char* table) const override;
+    void on_rollback() override;
+};
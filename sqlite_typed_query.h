@@ -0,0 +1,249 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Typed access to a SQLiteBinding connection for engine code. Binders and
+// column readers are picked at compile time, so no Array or Variant is built
+// on the way in or out:
+//
+//     LocalVector<std::tuple<int64_t, String>> rows =
+//             SQLiteTyped::query<int64_t, String>(db, "SELECT id, name FROM items WHERE price < ?", 15);
+//
+//     struct Item { int64_t id; String name; };
+//     LocalVector<Item> items = SQLiteTyped::query_into(db,
+//             SQLiteTyped::fields(&Item::id, &Item::name), "SELECT id, name FROM items");
+//
+// Statements come from the connection's statement cache, and the parameter
+// and column counts are checked against the prepared statement.
+
+#include "sqlite_binding.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/string/ustring.h"
+#include "core/templates/local_vector.h"
+#include "core/variant/variant.h"
+
+#include <sqlite3.h>
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace SQLiteTyped {
+
+// Column<T> binds a T to a parameter and reads a T from a result column.
+template <typename T>
+struct Column;
+
+template <>
+struct Column<bool> {
+    static int bind(sqlite3_stmt* stmt, int index, bool value) { return sqlite3_bind_int(stmt, index, value); }
+    static bool read(sqlite3_stmt* stmt, int column) { return sqlite3_column_int(stmt, column) != 0; }
+};
+
+template <>
+struct Column<int32_t> {
+    static int bind(sqlite3_stmt* stmt, int index, int32_t value) { return sqlite3_bind_int(stmt, index, value); }
+    static int32_t read(sqlite3_stmt* stmt, int column) { return sqlite3_column_int(stmt, column); }
+};
+
+template <>
+struct Column<int64_t> {
+    static int bind(sqlite3_stmt* stmt, int index, int64_t value) { return sqlite3_bind_int64(stmt, index, value); }
+    static int64_t read(sqlite3_stmt* stmt, int column) { return sqlite3_column_int64(stmt, column); }
+};
+
+template <>
+struct Column<float> {
+    static int bind(sqlite3_stmt* stmt, int index, float value) { return sqlite3_bind_double(stmt, index, value); }
+    static float read(sqlite3_stmt* stmt, int column) { return static_cast<float>(sqlite3_column_double(stmt, column)); }
+};
+
+template <>
+struct Column<double> {
+    static int bind(sqlite3_stmt* stmt, int index, double value) { return sqlite3_bind_double(stmt, index, value); }
+    static double read(sqlite3_stmt* stmt, int column) { return sqlite3_column_double(stmt, column); }
+};
+
+template <>
+struct Column<String> {
+    static int bind(sqlite3_stmt* stmt, int index, const String& value) {
+        const CharString utf8 = value.utf8();
+        return sqlite3_bind_text(stmt, index, utf8.get_data(), utf8.length(), SQLITE_TRANSIENT);
+    }
+    static String read(sqlite3_stmt* stmt, int column) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+        return SQLiteUtils::decode_utf8(text, sqlite3_column_bytes(stmt, column));
+    }
+};
+
+template <>
+struct Column<CharString> {
+    static int bind(sqlite3_stmt* stmt, int index, const CharString& value) {
+        return sqlite3_bind_text(stmt, index, value.get_data(), value.length(), SQLITE_TRANSIENT);
+    }
+};
+
+template <>
+struct Column<const char*> {
+    static int bind(sqlite3_stmt* stmt, int index, const char* value) {
+        return sqlite3_bind_text(stmt, index, value, -1, SQLITE_TRANSIENT);
+    }
+};
+
+template <>
+struct Column<PackedByteArray> {
+    static int bind(sqlite3_stmt* stmt, int index, const PackedByteArray& value) {
+        return SQLiteUtils::bind_blob(stmt, index, value);
+    }
+    static PackedByteArray read(sqlite3_stmt* stmt, int column) { return SQLiteUtils::column_blob(stmt, column); }
+};
+
+template <>
+struct Column<std::nullptr_t> {
+    static int bind(sqlite3_stmt* stmt, int index, std::nullptr_t) { return sqlite3_bind_null(stmt, index); }
+};
+
+// Members of S filled from consecutive result columns, see fields().
+template <typename S, typename... Fields>
+struct FieldList {
+    std::tuple<Fields S::*...> members;
+};
+
+template <typename S, typename... Fields>
+FieldList<S, Fields...> fields(Fields S::*... members) {
+    return { std::make_tuple(members...) };
+}
+
+namespace internal {
+
+// Maps argument types onto the binders above: string literals bind as text
+// and any integer type as the narrowest SQLite integer that holds it.
+template <typename T, typename D = std::decay_t<T>>
+using BindAs = std::conditional_t<std::is_same_v<D, char*>, const char*,
+        std::conditional_t<std::is_integral_v<D> && !std::is_same_v<D, bool>,
+                std::conditional_t<(sizeof(D) < 4 || (sizeof(D) == 4 && std::is_signed_v<D>)), int32_t, int64_t>, D>>;
+
+template <typename T>
+using ColumnOf = Column<BindAs<T>>;
+
+template <typename... Args, size_t... I>
+bool bind_all(sqlite3_stmt* stmt, std::index_sequence<I...>, const Args&... args) {
+    int result = SQLITE_OK;
+    // Stops at the first failing parameter.
+    ((result == SQLITE_OK ? (result = ColumnOf<Args>::bind(stmt, static_cast<int>(I) + 1, args)) : result), ...);
+    ERR_FAIL_COND_V_MSG(result != SQLITE_OK, false, "Failed to bind arguments, error code = " + itos(result));
+    return true;
+}
+
+template <typename... Ts, size_t... I>
+std::tuple<Ts...> read_all(sqlite3_stmt* stmt, std::index_sequence<I...>) {
+    return std::tuple<Ts...>(Column<Ts>::read(stmt, static_cast<int>(I))...);
+}
+
+template <typename S, typename... Fields, size_t... I>
+void read_into(sqlite3_stmt* stmt, S& r_value, const FieldList<S, Fields...>& list, std::index_sequence<I...>) {
+    ((r_value.*std::get<I>(list.members) = Column<Fields>::read(stmt, static_cast<int>(I))), ...);
+}
+
+// Fetches the cached statement and binds the arguments, validating both
+// counts. Returns nullptr on failure.
+template <typename... Args>
+sqlite3_stmt* start(SQLiteBinding& db, const String& sql, int column_count, const Args&... args) {
+    ERR_FAIL_NULL_V(db.get_handle(), nullptr);
+    sqlite3_stmt* stmt = db.get_cached_statement(sql);
+    if (stmt == nullptr) {
+        return nullptr;
+    }
+    const int param_count = sqlite3_bind_parameter_count(stmt);
+    ERR_FAIL_COND_V_MSG(param_count != static_cast<int>(sizeof...(Args)), nullptr,
+        "Failed to bind arguments [Wrong Count]: expected " + itos(param_count) + ", got " + itos(sizeof...(Args)));
+    ERR_FAIL_COND_V_MSG(column_count >= 0 && sqlite3_column_count(stmt) != column_count, nullptr,
+        "Wrong column count: query returns " + itos(sqlite3_column_count(stmt)) + ", expected " + itos(column_count));
+    if (!bind_all(stmt, std::index_sequence_for<Args...>(), args...)) {
+        sqlite3_reset(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+// Steps through the result, calling `on_row` for every row.
+template <typename F>
+bool step_all(SQLiteBinding& db, sqlite3_stmt* stmt, F&& on_row) {
+    int result = SQLITE_ROW;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        on_row();
+    }
+    sqlite3_reset(stmt);
+    ERR_FAIL_COND_V_MSG(result != SQLITE_DONE, false, "Failed to step: " + String::utf8(sqlite3_errmsg(db.get_handle())));
+    return true;
+}
+
+}
+
+// Runs a statement that returns no rows.
+template <typename... Args>
+bool exec(SQLiteBinding& db, const String& sql, const Args&... args) {
+    sqlite3_stmt* stmt = internal::start(db, sql, -1, args...);
+    if (stmt == nullptr) {
+        return false;
+    }
+    return internal::step_all(db, stmt, [] {});
+}
+
+// Returns every row as a std::tuple<Ts...>. The query must select exactly
+// sizeof...(Ts) columns.
+template <typename... Ts, typename... Args>
+LocalVector<std::tuple<Ts...>> query(SQLiteBinding& db, const String& sql, const Args&... args) {
+    LocalVector<std::tuple<Ts...>> rows;
+    sqlite3_stmt* stmt = internal::start(db, sql, sizeof...(Ts), args...);
+    if (stmt == nullptr) {
+        return rows;
+    }
+    if (!internal::step_all(db, stmt, [&] { rows.push_back(internal::read_all<Ts...>(stmt, std::index_sequence_for<Ts...>())); })) {
+        rows.clear();
+    }
+    return rows;
+}
+
+// Returns every row as an S whose listed members are filled in column order.
+template <typename S, typename... Fields, typename... Args>
+LocalVector<S> query_into(SQLiteBinding& db, const FieldList<S, Fields...>& list, const String& sql, const Args&... args) {
+    LocalVector<S> rows;
+    sqlite3_stmt* stmt = internal::start(db, sql, sizeof...(Fields), args...);
+    if (stmt == nullptr) {
+        return rows;
+    }
+    const bool ok = internal::step_all(db, stmt, [&] {
+        S value{};
+        internal::read_into(stmt, value, list, std::index_sequence_for<Fields...>());
+        rows.push_back(value);
+    });
+    if (!ok) {
+        rows.clear();
+    }
+    return rows;
+}
+
+}
@@ -0,0 +1,270 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_unit_of_work.h"
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/object/class_db.h"
+
+#include <sqlite3.h>
+
+using namespace SQLiteUtils;
+
+namespace {
+
+// One pending write: the values to bind, in statement order, and the
+// property values to remember once the transaction commits.
+struct PendingWrite {
+    ObjectID object;
+    LocalVector<Variant> values;
+    LocalVector<Variant> current;
+};
+
+}
+
+void SQLiteUnitOfWork::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_database", "database"), &SQLiteUnitOfWork::set_database);
+    ClassDB::bind_method(D_METHOD("get_database"), &SQLiteUnitOfWork::get_database);
+    ClassDB::bind_method(D_METHOD("track", "object", "table", "key_column"), &SQLiteUnitOfWork::track);
+    ClassDB::bind_method(D_METHOD("track_all", "objects", "table", "key_column"), &SQLiteUnitOfWork::track_all);
+    ClassDB::bind_method(D_METHOD("add", "object", "table", "key_column"), &SQLiteUnitOfWork::add);
+    ClassDB::bind_method(D_METHOD("untrack", "object"), &SQLiteUnitOfWork::untrack);
+    ClassDB::bind_method(D_METHOD("clear"), &SQLiteUnitOfWork::clear);
+    ClassDB::bind_method(D_METHOD("is_dirty", "object"), &SQLiteUnitOfWork::is_dirty);
+    ClassDB::bind_method(D_METHOD("get_tracked_count"), &SQLiteUnitOfWork::get_tracked_count);
+    ClassDB::bind_method(D_METHOD("flush"), &SQLiteUnitOfWork::flush);
+}
+
+SQLiteUnitOfWork::SQLiteUnitOfWork() = default;
+
+void SQLiteUnitOfWork::set_database(const Ref<SQLiteBinding>& database) {
+    db = database;
+    clear();
+}
+
+void SQLiteUnitOfWork::clear() {
+    tables.clear();
+    entries.clear();
+}
+
+const SQLiteUnitOfWork::TableInfo* SQLiteUnitOfWork::_get_table(const String& table, const String& key_column) {
+    HashMap<String, TableInfo>::Iterator existing = tables.find(table);
+    if (existing) {
+        ERR_FAIL_COND_V_MSG(existing->value.key_column != key_column, nullptr,
+            "Table " + table + " is already tracked with key column " + existing->value.key_column);
+        return &existing->value;
+    }
+
+    ERR_FAIL_COND_V(db.is_null(), nullptr);
+    TableInfo info;
+    info.key_column = key_column;
+    const Array columns = db->query_fetch_rows("PRAGMA table_info(" + quote_identifier(table) + ")");
+    for (int i = 0; i < columns.size(); ++i) {
+        const String name = Dictionary(columns[i])["name"];
+        if (name == key_column) {
+            info.key_index = i;
+        }
+        info.columns.push_back(name);
+        info.properties.push_back(StringName(name));
+    }
+    ERR_FAIL_COND_V_MSG(info.key_index < 0, nullptr, "Table " + table + " has no column " + key_column);
+    return &tables.insert(table, info)->value;
+}
+
+bool SQLiteUnitOfWork::_track(Object* object, const String& table, const String& key_column, bool is_new) {
+    ERR_FAIL_NULL_V(object, false);
+    const TableInfo* info = _get_table(table, key_column);
+    if (info == nullptr) {
+        return false;
+    }
+    Entry entry;
+    entry.table = table;
+    entry.is_new = is_new;
+    entry.snapshot.resize(info->properties.size());
+    for (uint32_t i = 0; i < info->properties.size(); ++i) {
+        entry.snapshot[i] = object->get(info->properties[i]);
+    }
+    entries.insert(object->get_instance_id(), entry);
+    return true;
+}
+
+bool SQLiteUnitOfWork::track(Object* object, const String& table, const String& key_column) {
+    return _track(object, table, key_column, false);
+}
+
+bool SQLiteUnitOfWork::track_all(const Array& objects, const String& table, const String& key_column) {
+    for (int i = 0; i < objects.size(); ++i) {
+        if (!_track(objects[i], table, key_column, false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SQLiteUnitOfWork::add(Object* object, const String& table, const String& key_column) {
+    return _track(object, table, key_column, true);
+}
+
+void SQLiteUnitOfWork::untrack(Object* object) {
+    ERR_FAIL_NULL(object);
+    entries.erase(object->get_instance_id());
+}
+
+bool SQLiteUnitOfWork::is_dirty(Object* object) const {
+    ERR_FAIL_NULL_V(object, false);
+    HashMap<ObjectID, Entry>::ConstIterator entry = entries.find(object->get_instance_id());
+    if (!entry) {
+        return false;
+    }
+    if (entry->value.is_new) {
+        return true;
+    }
+    const TableInfo& info = tables[entry->value.table];
+    for (uint32_t i = 0; i < info.properties.size(); ++i) {
+        if (object->get(info.properties[i]) != entry->value.snapshot[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SQLiteUnitOfWork::_exec(const char* query) {
+    char* error = nullptr;
+    if (sqlite3_exec(db->get_handle(), query, nullptr, nullptr, &error) != SQLITE_OK) {
+        print_error(String("Failed to execute ") + query + ": " + error);
+        sqlite3_free(error);
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteUnitOfWork::flush() {
+    ERR_FAIL_COND_V(db.is_null() || db->get_handle() == nullptr, false);
+
+    // Writes are grouped by the statement they need, i.e. by table and by
+    // the set of changed columns, so each group reuses one cached statement.
+    HashMap<String, LocalVector<PendingWrite>> groups;
+    LocalVector<ObjectID> freed;
+    for (const KeyValue<ObjectID, Entry>& E : entries) {
+        Object* object = ObjectDB::get_instance(E.key);
+        if (object == nullptr) {
+            freed.push_back(E.key);
+            continue;
+        }
+        const Entry& entry = E.value;
+        const TableInfo& info = tables[entry.table];
+
+        PendingWrite write;
+        write.object = E.key;
+        write.current.resize(info.properties.size());
+        LocalVector<int> changed;
+        for (uint32_t i = 0; i < info.properties.size(); ++i) {
+            bool valid = false;
+            write.current[i] = object->get(info.properties[i], &valid);
+            if (entry.is_new ? valid : write.current[i] != entry.snapshot[i]) {
+                changed.push_back(i);
+            }
+        }
+        if (changed.is_empty()) {
+            continue;
+        }
+
+        String sql;
+        if (entry.is_new) {
+            String columns;
+            String placeholders;
+            String updates;
+            for (int i : changed) {
+                const String column = quote_identifier(info.columns[i]);
+                columns += (columns.is_empty() ? "" : ", ") + column;
+                placeholders += placeholders.is_empty() ? "?" : ", ?";
+                if (i != info.key_index) {
+                    updates += (updates.is_empty() ? "" : ", ") + column + " = excluded." + column;
+                }
+                write.values.push_back(write.current[i]);
+            }
+            sql = "INSERT INTO " + quote_identifier(entry.table) + " (" + columns + ") VALUES (" + placeholders +
+                ") ON CONFLICT (" + quote_identifier(info.key_column) + ") DO " +
+                (updates.is_empty() ? String("NOTHING") : "UPDATE SET " + updates);
+        } else {
+            String updates;
+            for (int i : changed) {
+                updates += (updates.is_empty() ? "" : ", ") + quote_identifier(info.columns[i]) + " = ?";
+                write.values.push_back(write.current[i]);
+            }
+            // The row is addressed by the key it was loaded with.
+            write.values.push_back(entry.snapshot[info.key_index]);
+            sql = "UPDATE " + quote_identifier(entry.table) + " SET " + updates + " WHERE " +
+                quote_identifier(info.key_column) + " = ?";
+        }
+
+        HashMap<String, LocalVector<PendingWrite>>::Iterator group = groups.find(sql);
+        if (!group) {
+            group = groups.insert(sql, LocalVector<PendingWrite>());
+        }
+        group->value.push_back(write);
+    }
+    for (const ObjectID& id : freed) {
+        entries.erase(id);
+    }
+    if (groups.is_empty()) {
+        return true;
+    }
+
+    // A savepoint, so that flushing also works inside the caller's transaction.
+    if (!_exec("SAVEPOINT unit_of_work")) {
+        return false;
+    }
+    for (const KeyValue<String, LocalVector<PendingWrite>>& group : groups) {
+        sqlite3_stmt* stmt = db->get_cached_statement(group.key);
+        bool ok = stmt != nullptr;
+        for (uint32_t w = 0; ok && w < group.value.size(); ++w) {
+            const PendingWrite& write = group.value[w];
+            for (uint32_t i = 0; ok && i < write.values.size(); ++i) {
+                ok = bind_value(stmt, i + 1, write.values[i]);
+            }
+            if (ok && sqlite3_step(stmt) != SQLITE_DONE) {
+                print_error("Failed to flush: " + String::utf8(sqlite3_errmsg(db->get_handle())));
+                ok = false;
+            }
+            sqlite3_reset(stmt);
+        }
+        if (!ok) {
+            _exec("ROLLBACK TO unit_of_work; RELEASE unit_of_work");
+            return false;
+        }
+    }
+    if (!_exec("RELEASE unit_of_work")) {
+        _exec("ROLLBACK TO unit_of_work; RELEASE unit_of_work");
+        return false;
+    }
+
+    for (const KeyValue<String, LocalVector<PendingWrite>>& group : groups) {
+        for (const PendingWrite& write : group.value) {
+            Entry& entry = entries[write.object];
+            entry.snapshot = write.current;
+            entry.is_new = false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "sqlite_binding.h"
+
+#include "core/object/object_id.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+// Tracks mapped objects and writes back only the columns whose property
+// values changed since they were loaded (or last flushed).
+class SQLiteUnitOfWork : public RefCounted {
+    GDCLASS(SQLiteUnitOfWork, RefCounted);
+
+    struct TableInfo {
+        String key_column;
+        int key_index = -1;
+        PackedStringArray columns;
+        LocalVector<StringName> properties;
+    };
+
+    struct Entry {
+        String table;
+        LocalVector<Variant> snapshot;
+        bool is_new = false;
+    };
+
+    Ref<SQLiteBinding> db;
+    HashMap<String, TableInfo> tables;
+    HashMap<ObjectID, Entry> entries;
+
+    const TableInfo* _get_table(const String& table, const String& key_column);
+    bool _track(Object* object, const String& table, const String& key_column, bool is_new);
+    bool _exec(const char* query);
+
+protected:
+    static void _bind_methods();
+
+public:
+    SQLiteUnitOfWork();
+
+    void set_database(const Ref<SQLiteBinding>& database);
+    Ref<SQLiteBinding> get_database() const { return db; }
+
+    bool track(Object* object, const String& table, const String& key_column);
+    bool track_all(const Array& objects, const String& table, const String& key_column);
+    bool add(Object* object, const String& table, const String& key_column);
+    void untrack(Object* object);
+    void clear();
+
+    bool is_dirty(Object* object) const;
+    int get_tracked_count() const { return entries.size(); }
+
+    bool flush();
+};
@@ -0,0 +1,488 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_utils.h"
+
+#include "core/error/error_macros.h"
+#include "core/io/compression.h"
+#include "core/io/marshalls.h"
+#include "core/templates/hashfuncs.h"
+#include "core/variant/variant.h"
+
+#include <sqlite3.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SQLITE_UTILS_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define SQLITE_UTILS_NEON
+#endif
+
+namespace SQLiteUtils {
+
+sqlite3_stmt* prepare(sqlite3* db, const char* query) {
+    ERR_FAIL_COND_V(db == nullptr, nullptr);
+    sqlite3_stmt* stmt = nullptr;
+    int result = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
+    ERR_FAIL_COND_V(result != SQLITE_OK, nullptr);
+    return stmt;
+}
+
+String quote_identifier(const String& name) {
+    return "\"" + name.replace("\"", "\"\"") + "\"";
+}
+
+String file_uri(const String& path) {
+    String uri_path = path.replace("\\", "/");
+    if (!uri_path.begins_with("/")) {
+        // Windows drive paths, see https://www.sqlite.org/uri.html.
+        uri_path = "/" + uri_path;
+    }
+    return "file:" + uri_path.replace("%", "%25").replace("?", "%3F").replace("#", "%23");
+}
+
+static const char* BLOB_COMPRESSION_KEY = "godot_blob_compression";
+// Magic (3 bytes), compression mode (1 byte), uncompressed size (u32) and a
+// hash of those 8 bytes (u32), so a raw blob is only taken for a compressed
+// one by a 1 in 2^32 chance.
+static const uint8_t BLOB_MAGIC[3] = { 0x89, 'G', 'Z' };
+static const int BLOB_HEADER_SIZE = 12;
+// Headers claiming a higher ratio are rejected before anything is allocated;
+// blobs that really compress better than this are stored raw.
+static const int64_t BLOB_MAX_RATIO = 1024;
+
+static void free_blob_compression(void* data) {
+    memdelete(static_cast<BlobCompression*>(data));
+}
+
+void set_blob_compression(sqlite3* db, int mode, int threshold) {
+    BlobCompression* settings = nullptr;
+    if (mode >= 0) {
+        settings = memnew(BlobCompression);
+        settings->mode = mode;
+        settings->threshold = threshold;
+    }
+    sqlite3_set_clientdata(db, BLOB_COMPRESSION_KEY, settings, settings ? &free_blob_compression : nullptr);
+}
+
+const BlobCompression* get_blob_compression(sqlite3* db) {
+    return static_cast<const BlobCompression*>(sqlite3_get_clientdata(db, BLOB_COMPRESSION_KEY));
+}
+
+// Binds `blob` compressed when that makes it smaller.
+static int bind_compressed_blob(sqlite3_stmt* stmt, int index, const PackedByteArray& blob,
+        const BlobCompression& settings) {
+    const Compression::Mode mode = Compression::Mode(settings.mode);
+    PackedByteArray packed;
+    packed.resize(BLOB_HEADER_SIZE + Compression::get_max_compressed_buffer_size(blob.size(), mode));
+    uint8_t* out = packed.ptrw();
+    const int64_t size = Compression::compress(out + BLOB_HEADER_SIZE, blob.ptr(), blob.size(), mode);
+    if (size < 0 || BLOB_HEADER_SIZE + size >= blob.size() || blob.size() > BLOB_MAX_RATIO * size) {
+        return sqlite3_bind_blob(stmt, index, blob.ptr(), blob.size(), SQLITE_TRANSIENT);
+    }
+    memcpy(out, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+    out[3] = uint8_t(mode);
+    encode_uint32(blob.size(), out + 4);
+    encode_uint32(hash_murmur3_buffer(out, 8), out + 8);
+    return sqlite3_bind_blob(stmt, index, out, BLOB_HEADER_SIZE + size, SQLITE_TRANSIENT);
+}
+
+bool decompress_blob(const uint8_t* data, int size, PackedByteArray& out) {
+    if (size < BLOB_HEADER_SIZE || memcmp(data, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0 ||
+            data[3] > Compression::MODE_BROTLI || decode_uint32(data + 8) != hash_murmur3_buffer(data, 8)) {
+        return false;
+    }
+    const uint32_t original_size = decode_uint32(data + 4);
+    if (original_size > BLOB_MAX_RATIO * (size - BLOB_HEADER_SIZE)) {
+        return false;
+    }
+    PackedByteArray result;
+    if (result.resize(original_size) != OK) {
+        return false;
+    }
+    const int64_t decoded = Compression::decompress(result.ptrw(), original_size, data + BLOB_HEADER_SIZE,
+        size - BLOB_HEADER_SIZE, Compression::Mode(data[3]));
+    // A damaged payload behind a valid header.
+    if (decoded != int64_t(original_size)) {
+        return false;
+    }
+    out = result;
+    return true;
+}
+
+static void sql_decompress(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    sqlite3_value* value = argv[0];
+    if (sqlite3_value_type(value) == SQLITE_BLOB) {
+        PackedByteArray blob;
+        const uint8_t* data = static_cast<const uint8_t*>(sqlite3_value_blob(value));
+        if (decompress_blob(data, sqlite3_value_bytes(value), blob)) {
+            sqlite3_result_blob(context, blob.ptr(), blob.size(), SQLITE_TRANSIENT);
+            return;
+        }
+    }
+    sqlite3_result_value(context, value);
+}
+
+int bind_blob(sqlite3_stmt* stmt, int index, const PackedByteArray& blob) {
+    const BlobCompression* compression = get_blob_compression(sqlite3_db_handle(stmt));
+    if (compression != nullptr && blob.size() >= compression->threshold) {
+        return bind_compressed_blob(stmt, index, blob, *compression);
+    }
+    return sqlite3_bind_blob(stmt, index, blob.ptr(), blob.size(), SQLITE_TRANSIENT);
+}
+
+static PackedByteArray copy_blob(const uint8_t* data, int size) {
+    PackedByteArray arr;
+    arr.resize(size);
+    if (size > 0) {
+        memcpy(arr.ptrw(), data, size);
+    }
+    return arr;
+}
+
+PackedByteArray column_blob(sqlite3_stmt* stmt, int column) {
+    const uint8_t* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, column));
+    const int size = sqlite3_column_bytes(stmt, column);
+    PackedByteArray arr;
+    if (decompress_blob(blob, size, arr)) {
+        return arr;
+    }
+    return copy_blob(blob, size);
+}
+
+void register_blob_functions(sqlite3* db) {
+    sqlite3_create_function_v2(db, "decompress", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS, nullptr,
+        &sql_decompress, nullptr, nullptr, nullptr);
+}
+
+bool bind_value(sqlite3_stmt* stmt, int index, const Variant& value) {
+    int result = SQLITE_OK;
+    const Variant::Type type = value.get_type();
+    switch (type) {
+    case Variant::Type::PACKED_BYTE_ARRAY:
+    {
+        result = bind_blob(stmt, index, value);
+        break;
+    }
+    case Variant::Type::FLOAT:
+        result = sqlite3_bind_double(stmt, index, static_cast<double>(value));
+        break;
+    case Variant::Type::BOOL:
+    case Variant::Type::INT:
+        result = sqlite3_bind_int64(stmt, index, static_cast<int64_t>(value));
+        break;
+    case Variant::Type::NIL:
+        result = sqlite3_bind_null(stmt, index);
+        break;
+    case Variant::Type::STRING:
+        result = sqlite3_bind_text(stmt, index, String(value).utf8().get_data(), -1, SQLITE_TRANSIENT);
+        break;
+    default:
+        print_error("Unsupported type: " + itos(type));
+        return false;
+    }
+
+    if (result != SQLITE_OK) {
+        print_error(
+            "Failed to bind argument at [" + itos(index) +
+            "] with type " + itos(type) +
+            ", error code = " + itos(result)
+        );
+        return false;
+    }
+    return true;
+}
+
+bool bind_args(sqlite3_stmt* stmt, const Array& args) {
+    const int param_count = sqlite3_bind_parameter_count(stmt);
+    if (param_count != args.size()) {
+        print_error("Failed to bind arguments [Wrong Count]: expected " + itos(param_count) +
+            ", got " + itos(args.size()));
+        return false;
+    }
+
+    for (int i = 0; i < param_count; ++i) {
+        if (!bind_value(stmt, i + 1, args[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Variant decode_integer(sqlite3_stmt* stmt, int column) {
+    return static_cast<int64_t>(sqlite3_column_int64(stmt, column));
+}
+
+static Variant decode_float(sqlite3_stmt* stmt, int column) {
+    return sqlite3_column_double(stmt, column);
+}
+
+// Widens 16 bytes into `dst` when all of them are ASCII and none is NUL,
+// otherwise returns false and leaves `dst` alone.
+static inline bool widen_ascii_16(const uint8_t* src, char32_t* dst) {
+#if defined(SQLITE_UTILS_SSE2)
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i zero = _mm_setzero_si128();
+    if (_mm_movemask_epi8(_mm_or_si128(bytes, _mm_cmpeq_epi8(bytes, zero))) != 0) {
+        return false;
+    }
+    const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    __m128i* out = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+    return true;
+#elif defined(SQLITE_UTILS_NEON)
+    const uint8x16_t bytes = vld1q_u8(src);
+    if (vmaxvq_u8(bytes) >= 0x80 || vminvq_u8(bytes) == 0) {
+        return false;
+    }
+    const uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+    const uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+    uint32_t* out = reinterpret_cast<uint32_t*>(dst);
+    vst1q_u32(out, vmovl_u16(vget_low_u16(low)));
+    vst1q_u32(out + 4, vmovl_u16(vget_high_u16(low)));
+    vst1q_u32(out + 8, vmovl_u16(vget_low_u16(high)));
+    vst1q_u32(out + 12, vmovl_u16(vget_high_u16(high)));
+    return true;
+#else
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    uint64_t words[2];
+    memcpy(words, src, sizeof(words));
+    for (const uint64_t word : words) {
+        // A high bit set, or a zero byte.
+        if ((word & highs) != 0 || ((word - ones) & ~word & highs) != 0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        dst[i] = src[i];
+    }
+    return true;
+#endif
+}
+
+// Decodes into `dst`, which has room for `length` characters. Returns the
+// number written, or -1 for input this does not handle the way
+// String::utf8() does (invalid sequences).
+static int64_t decode_utf8_into(const uint8_t* src, int length, char32_t* dst) {
+    const uint8_t* end = src + length;
+    char32_t* out = dst;
+    while (src < end) {
+        if (end - src >= 16 && widen_ascii_16(src, out)) {
+            src += 16;
+            out += 16;
+            continue;
+        }
+        // Finish the block one character at a time before trying again, so
+        // mostly non-ASCII text does not pay for a failed check per character.
+        const uint8_t* block_end = MIN(src + 16, end);
+        while (src < block_end) {
+            const uint8_t lead = *src;
+            if (lead < 0x80) {
+                if (lead == 0) {
+                    // String::utf8() stops at NUL as well.
+                    return out - dst;
+                }
+                *out++ = lead;
+                ++src;
+                continue;
+            }
+            int size = 0;
+            char32_t c = 0;
+            char32_t min = 0;
+            if ((lead & 0xE0) == 0xC0) {
+                size = 2;
+                c = lead & 0x1F;
+                min = 0x80;
+            } else if ((lead & 0xF0) == 0xE0) {
+                size = 3;
+                c = lead & 0x0F;
+                min = 0x800;
+            } else if ((lead & 0xF8) == 0xF0) {
+                size = 4;
+                c = lead & 0x07;
+                min = 0x10000;
+            } else {
+                return -1;
+            }
+            if (end - src < size) {
+                return -1;
+            }
+            for (int i = 1; i < size; ++i) {
+                if ((src[i] & 0xC0) != 0x80) {
+                    return -1;
+                }
+                c = (c << 6) | (src[i] & 0x3F);
+            }
+            if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+                return -1;
+            }
+            *out++ = c;
+            src += size;
+        }
+    }
+    return out - dst;
+}
+
+String decode_utf8(const char* text, int length) {
+    if (text == nullptr || length <= 0) {
+        return String();
+    }
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(text);
+    // String::utf8() skips a byte order mark.
+    if (length >= 3 && src[0] == 0xEF && src[1] == 0xBB && src[2] == 0xBF) {
+        return String::utf8(text, length);
+    }
+    String result;
+    // Never more characters than bytes, shrunk below when there are fewer.
+    result.resize(length + 1);
+    char32_t* dst = result.ptrw();
+    const int64_t count = decode_utf8_into(src, length, dst);
+    if (count < 0) {
+        // Let String::utf8() report and replace the invalid sequences.
+        return String::utf8(text, length);
+    }
+    if (count == 0) {
+        return String();
+    }
+    dst[count] = 0;
+    if (count < length) {
+        result.resize(count + 1);
+    }
+    return result;
+}
+
+static Variant decode_text(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return decode_utf8(text, sqlite3_column_bytes(stmt, column));
+}
+
+static Variant decode_blob(sqlite3_stmt* stmt, int column) {
+    return column_blob(stmt, column);
+}
+
+static RowDecoder::DecodeFunc get_decoder(int type) {
+    switch (type) {
+    case SQLITE_INTEGER:
+        return &decode_integer;
+    case SQLITE_FLOAT:
+        return &decode_float;
+    case SQLITE_TEXT:
+        return &decode_text;
+    case SQLITE_BLOB:
+        return &decode_blob;
+    default:
+        return nullptr;
+    }
+}
+
+// Storage class most values of a column with this declared type will have,
+// following SQLite's affinity rules; 0 when it cannot be guessed.
+int get_declared_type(const char* decltype_name) {
+    if (decltype_name == nullptr) {
+        return 0;
+    }
+    const String name = String(decltype_name).to_upper();
+    if (name.contains("INT")) {
+        return SQLITE_INTEGER;
+    }
+    if (name.contains("CHAR") || name.contains("CLOB") || name.contains("TEXT")) {
+        return SQLITE_TEXT;
+    }
+    if (name.contains("BLOB")) {
+        return SQLITE_BLOB;
+    }
+    if (name.contains("REAL") || name.contains("FLOA") || name.contains("DOUB")) {
+        return SQLITE_FLOAT;
+    }
+    return 0;
+}
+
+Variant column_value(sqlite3_stmt* stmt, int column) {
+    const int type = sqlite3_column_type(stmt, column);
+    if (type == SQLITE_NULL) {
+        return Variant();
+    }
+    if (type == SQLITE_BLOB) {
+        return column_blob(stmt, column);
+    }
+    const RowDecoder::DecodeFunc decode = get_decoder(type);
+    if (decode == nullptr) {
+        print_error("Unsupported column type: " + itos(type));
+        return Variant();
+    }
+    return decode(stmt, column);
+}
+
+Dictionary fetch_row(sqlite3_stmt* stmt) {
+    Dictionary result;
+    const int column_count = sqlite3_column_count(stmt);
+    for (int i = 0; i < column_count; ++i) {
+        if (sqlite3_column_type(stmt, i) == SQLITE_NULL) {
+            continue;
+        }
+        result[String::utf8(sqlite3_column_name(stmt, i))] = column_value(stmt, i);
+    }
+    return result;
+}
+
+RowDecoder::RowDecoder(sqlite3_stmt* stmt) {
+    const int column_count = sqlite3_column_count(stmt);
+    columns.resize(column_count);
+    for (int i = 0; i < column_count; ++i) {
+        Column& column = columns[i];
+        column.name = String::utf8(sqlite3_column_name(stmt, i));
+        column.type = get_declared_type(sqlite3_column_decltype(stmt, i));
+        column.decode = get_decoder(column.type);
+    }
+}
+
+Dictionary RowDecoder::fetch_row(sqlite3_stmt* stmt) {
+    Dictionary result;
+    for (uint32_t i = 0; i < columns.size(); ++i) {
+        Column& column = columns[i];
+        const int type = sqlite3_column_type(stmt, i);
+        if (type == SQLITE_NULL) {
+            continue;
+        }
+        if (type != column.type) {
+            if (column.type != 0) {
+                // Values that do not match the column's usual type are rare
+                // (SQLite columns are dynamically typed), take the slow path.
+                result[column.name] = column_value(stmt, i);
+                continue;
+            }
+            // Expressions have no declared type: adopt the first value's.
+            column.type = type;
+            column.decode = get_decoder(type);
+        }
+        result[column.name] = column.decode(stmt, i);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/variant/array.h"
+#include "core/templates/local_vector.h"
+#include "core/variant/dictionary.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Statement helpers shared by SQLiteBinding and the classes built on top of it.
+namespace SQLiteUtils {
+
+[[nodiscard]] sqlite3_stmt* prepare(sqlite3* db, const char* query);
+// Quotes a table or column name for use in generated SQL.
+[[nodiscard]] String quote_identifier(const String& name);
+// Turns an absolute file system path into a "file:" URI for SQLITE_OPEN_URI.
+[[nodiscard]] String file_uri(const String& path);
+// Compression of PackedByteArray values, per connection. While enabled,
+// blobs of at least `threshold` bytes are stored compressed behind a small
+// header. Every blob read back is decompressed when it has that header,
+// whether or not compression is enabled on the reading connection.
+struct BlobCompression {
+    int mode = -1;
+    int threshold = 256;
+};
+
+// A negative mode turns compression off.
+void set_blob_compression(sqlite3* db, int mode, int threshold);
+[[nodiscard]] const BlobCompression* get_blob_compression(sqlite3* db);
+// Returns false, leaving `out` alone, when `data` is not a compressed blob.
+bool decompress_blob(const uint8_t* data, int size, PackedByteArray& out);
+// Binds a blob, compressed when the connection is set up to, or reads one,
+// decompressed when it has the header.
+int bind_blob(sqlite3_stmt* stmt, int index, const PackedByteArray& blob);
+[[nodiscard]] PackedByteArray column_blob(sqlite3_stmt* stmt, int column);
+// Registers decompress(blob) on `db`; other values are returned unchanged.
+void register_blob_functions(sqlite3* db);
+
+// Same result as String::utf8(text, length), with ASCII runs widened 16
+// bytes at a time (SSE2 or NEON where available). Used for text columns.
+[[nodiscard]] String decode_utf8(const char* text, int length);
+
+// Binds `value` to the 1-based parameter `index`.
+bool bind_value(sqlite3_stmt* stmt, int index, const Variant& value);
+bool bind_args(sqlite3_stmt* stmt, const Array& args);
+// SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB for a declared
+// column type by SQLite's affinity rules, 0 when there is none.
+[[nodiscard]] int get_declared_type(const char* decltype_name);
+// Converts one column of the current row; NULL becomes an empty Variant.
+[[nodiscard]] Variant column_value(sqlite3_stmt* stmt, int column);
+[[nodiscard]] Dictionary fetch_row(sqlite3_stmt* stmt);
+
+// Converts the rows of one statement. Column names and per-column decoders
+// are resolved once, from the declared column types or, for expressions,
+// from the first non-NULL value; cells of another type take the generic path.
+class RowDecoder {
+public:
+    typedef Variant (*DecodeFunc)(sqlite3_stmt* stmt, int column);
+
+    explicit RowDecoder(sqlite3_stmt* stmt);
+    [[nodiscard]] Dictionary fetch_row(sqlite3_stmt* stmt);
+
+private:
+    struct Column {
+        Variant name;
+        int type = 0;
+        DecodeFunc decode = nullptr;
+    };
+    LocalVector<Column> columns;
+};
+
+}
@@ -0,0 +1,190 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "sqlite_write_through.h"
+
+#include "core/error/error_macros.h"
+#include "core/os/os.h"
+
+#include <sqlite3.h>
+
+SQLiteWriteThrough::SQLiteWriteThrough(sqlite3* p_memory, sqlite3* p_disk, int p_interval_msec) :
+        memory(p_memory), disk(p_disk), interval_msec(MAX(p_interval_msec, 1)) {
+}
+
+SQLiteWriteThrough::~SQLiteWriteThrough() {
+    stop();
+}
+
+static int read_schema_version(sqlite3* db) {
+    sqlite3_stmt* stmt = nullptr;
+    int version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA schema_version", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+// The memory database is the source of truth, so its rows always win.
+static int replace_on_conflict(void* user_data, int conflict, sqlite3_changeset_iter* iter) {
+    return conflict == SQLITE_CHANGESET_DATA || conflict == SQLITE_CHANGESET_CONFLICT ? SQLITE_CHANGESET_REPLACE
+                                                                                      : SQLITE_CHANGESET_OMIT;
+}
+
+// Must be called with the memory connection's mutex held, so no change falls
+// between the old session and the new one.
+bool SQLiteWriteThrough::_reset_session() {
+    if (session != nullptr) {
+        sqlite3session_delete(session);
+        session = nullptr;
+    }
+    if (sqlite3session_create(memory, "main", &session) != SQLITE_OK) {
+        return false;
+    }
+    // Track rowid tables without a declared primary key as well.
+    int track_rowid = 1;
+    sqlite3session_object_config(session, SQLITE_SESSION_OBJCONFIG_ROWID, &track_rowid);
+    return sqlite3session_attach(session, nullptr) == SQLITE_OK;
+}
+
+// Must be called with the memory connection's mutex held, outside a
+// transaction: copying in one step means only committed pages are copied.
+// The copy is a memory to memory transfer, so queries wait for a memcpy of
+// the database rather than for the file write.
+bool SQLiteWriteThrough::_copy_memory(sqlite3** r_copy) {
+    if (sqlite3_open(":memory:", r_copy) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_backup* backup = sqlite3_backup_init(*r_copy, "main", memory, "main");
+    if (backup == nullptr) {
+        return false;
+    }
+    sqlite3_backup_step(backup, -1);
+    return sqlite3_backup_finish(backup) == SQLITE_OK;
+}
+
+bool SQLiteWriteThrough::_backup(sqlite3* copy) {
+    sqlite3_backup* backup = sqlite3_backup_init(disk, "main", copy, "main");
+    ERR_FAIL_NULL_V_MSG(backup, false, "Failed to back up memory database: " + String::utf8(sqlite3_errmsg(disk)));
+    int rc = SQLITE_OK;
+    do {
+        rc = sqlite3_backup_step(backup, 256);
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            OS::get_singleton()->delay_usec(1000);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+    return sqlite3_backup_finish(backup) == SQLITE_OK && rc == SQLITE_DONE;
+}
+
+bool SQLiteWriteThrough::start() {
+    sqlite3_mutex_enter(sqlite3_db_mutex(memory));
+    const bool ok = _reset_session();
+    schema_version = read_schema_version(memory);
+    sqlite3_mutex_leave(sqlite3_db_mutex(memory));
+    ERR_FAIL_COND_V_MSG(!ok, false, "Failed to record changes: " + String::utf8(sqlite3_errmsg(memory)));
+    thread.start(&SQLiteWriteThrough::_thread_loop, this);
+    return true;
+}
+
+bool SQLiteWriteThrough::persist() {
+    MutexLock lock(persist_mutex);
+    if (disk == nullptr) {
+        return false;
+    }
+
+    int size = 0;
+    void* changeset = nullptr;
+    sqlite3* copy = nullptr;
+    bool ok = true;
+    sqlite3_mutex* memory_mutex = sqlite3_db_mutex(memory);
+    sqlite3_mutex_enter(memory_mutex);
+    if (!sqlite3_get_autocommit(memory)) {
+        // Uncommitted changes must not reach the file; try again later.
+        sqlite3_mutex_leave(memory_mutex);
+        return false;
+    }
+    // Statements compiled here, and by the session below, run the binding's
+    // authorizer and trace on this thread; the binding only changes what
+    // they read while holding this mutex.
+    const int version = read_schema_version(memory);
+    // New or altered tables cannot be replayed as a changeset.
+    needs_backup = needs_backup || version != schema_version;
+    if (needs_backup) {
+        ok = _reset_session() && _copy_memory(&copy);
+    } else if (!sqlite3session_isempty(session)) {
+        ok = sqlite3session_changeset(session, &size, &changeset) == SQLITE_OK && _reset_session();
+    }
+    schema_version = version;
+    sqlite3_mutex_leave(memory_mutex);
+
+    if (ok && needs_backup) {
+        ok = _backup(copy);
+        needs_backup = !ok;
+    } else if (ok && changeset != nullptr) {
+        ok = sqlite3changeset_apply(disk, size, changeset, nullptr, &replace_on_conflict, nullptr) == SQLITE_OK;
+        // A full copy next time is the only way back in sync.
+        needs_backup = !ok;
+    }
+    sqlite3_free(changeset);
+    sqlite3_close(copy);
+    if (!ok) {
+        print_error("Failed to persist memory database: " + String::utf8(sqlite3_errmsg(disk)));
+    }
+    return ok;
+}
+
+void SQLiteWriteThrough::_thread_loop(void* user_data) {
+    SQLiteWriteThrough* self = static_cast<SQLiteWriteThrough*>(user_data);
+    const uint64_t interval_usec = uint64_t(self->interval_msec) * 1000;
+    uint64_t next_persist_usec = OS::get_singleton()->get_ticks_usec() + interval_usec;
+    while (!self->exit.is_set()) {
+        // Sleep in short slices so stop() does not wait for a full interval.
+        OS::get_singleton()->delay_usec(MIN(self->interval_msec, 50) * 1000);
+        if (OS::get_singleton()->get_ticks_usec() < next_persist_usec) {
+            continue;
+        }
+        if (self->persist()) {
+            next_persist_usec = OS::get_singleton()->get_ticks_usec() + interval_usec;
+        }
+    }
+}
+
+bool SQLiteWriteThrough::stop() {
+    exit.set();
+    if (thread.is_started()) {
+        thread.wait_to_finish();
+    }
+    if (disk == nullptr) {
+        return true;
+    }
+    const bool ok = persist();
+    MutexLock lock(persist_mutex);
+    if (session != nullptr) {
+        sqlite3session_delete(session);
+        session = nullptr;
+    }
+    sqlite3_close(disk);
+    disk = nullptr;
+    return ok;
+}
@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2024 Amil Khisamov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+
+struct sqlite3;
+struct sqlite3_session;
+
+// Persists an in-memory database to a file on a background thread. Row
+// changes are recorded with a session and replayed on the file as a
+// changeset; schema changes, and any replay that fails, fall back to a full
+// backup. At most `interval_msec` of committed changes are lost on a crash.
+class SQLiteWriteThrough {
+    sqlite3* memory = nullptr;
+    sqlite3* disk = nullptr;
+    sqlite3_session* session = nullptr;
+    int interval_msec = 1000;
+    int schema_version = -1;
+    bool needs_backup = false;
+
+    // Serializes persist() between the thread and callers.
+    Mutex persist_mutex;
+    Thread thread;
+    SafeFlag exit;
+
+    static void _thread_loop(void* user_data);
+    bool _reset_session();
+    bool _copy_memory(sqlite3** r_copy);
+    bool _backup(sqlite3* copy);
+
+public:
+    // Takes ownership of `disk`, which must hold the same data as `memory`.
+    SQLiteWriteThrough(sqlite3* memory, sqlite3* disk, int interval_msec);
+    ~SQLiteWriteThrough();
+
+    bool start();
+    // Writes everything committed so far to the file. Returns false when
+    // the memory database is inside a transaction or the write failed.
+    bool persist();
+    // Stops the thread and persists a last time.
+    bool stop();
+};
@@ -22,10 +22,25 @@
 
 #pragma once
 
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/json.h"
+#include "core/io/marshalls.h"
+#include "core/io/resource.h"
+#include "core/object/message_queue.h"
+#include "core/os/os.h"
 #include "core/variant/array.h"
 #include "core/variant/dictionary.h"
 #include "tests/test_macros.h"
+#include "modules/sqlite_binding/sql_query_library.h"
 #include "modules/sqlite_binding/sqlite_binding.h"
+#include "modules/sqlite_binding/sqlite_connection_manager.h"
+#include "modules/sqlite_binding/sqlite_kv.h"
+#include "modules/sqlite_binding/sqlite_live_query.h"
+#include "modules/sqlite_binding/sqlite_shard_set.h"
+#include "modules/sqlite_binding/sqlite_typed_query.h"
+#include "modules/sqlite_binding/sqlite_unit_of_work.h"
+#include "modules/sqlite_binding/sqlite_utils.h"
 #include <map>
 
 namespace TestSQLiteBinding {
@@ -56,6 +71,9 @@ TEST_CASE("[Modules][SQLiteBinding]") {
     CHECK(sqlite->query_with_args(query, Dictionary(fruits_to_insert[0]).values()));
     CHECK(sqlite->query_with_args(query, Dictionary(fruits_to_insert[1]).values()));
     CHECK(sqlite->query_with_args(query, Dictionary(fruits_to_insert[2]).values()));
+    ERR_PRINT_OFF;
+    CHECK_FALSE(sqlite->query_with_args(query, Dictionary(fruits_to_insert[0]).values()));
+    ERR_PRINT_ON;
 
     query = "SELECT * FROM fruits";
     CHECK(sqlite->query_fetch_rows(query) == fruits_to_insert);
@@ -74,4 +92,1354 @@ TEST_CASE("[Modules][SQLiteBinding]") {
     CHECK(sqlite->close());
 }
 
+TEST_CASE("[Modules][SQLiteBinding] Object hydration") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->execute_script("CREATE TABLE fruits (name TEXT, price INTEGER);"
+                                 "INSERT INTO fruits VALUES ('apple', 14), ('orange', 30), ('banana', 42);"));
+
+    Array objects = sqlite->query_fetch_objects("SELECT name AS resource_name FROM fruits ORDER BY price", Array(), "Resource");
+    REQUIRE(objects.size() == 3);
+    Ref<Resource> first = objects[0];
+    CHECK(first.is_valid());
+    CHECK(first->get_name() == "apple");
+
+    // Properties without a bound setter go through Object::set.
+    objects = sqlite->query_fetch_objects("SELECT name AS \"metadata/fruit\" FROM fruits ORDER BY price", Array(), "Resource");
+    REQUIRE(objects.size() == 3);
+    CHECK(Ref<Resource>(objects[2])->get_meta("fruit") == "banana");
+
+    ERR_PRINT_OFF;
+    // An int cannot go to the String setter, which fails the whole fetch.
+    CHECK(sqlite->query_fetch_objects("SELECT price AS resource_name FROM fruits ORDER BY price", Array(), "Resource").is_empty());
+    // Failing steps give no objects, like the other fetch functions.
+    CHECK(sqlite->query_fetch_objects("SELECT abs(-9223372036854775807 - 1) AS resource_name", Array(), "Resource").is_empty());
+    ERR_PRINT_ON;
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Value fidelity") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE events (id INTEGER, label TEXT, extra)"));
+
+    Array args;
+    args.push_back(int64_t(1) << 40);
+    args.push_back(String::utf8("héllo"));
+    args.push_back(2.5);
+    CHECK(sqlite->query_with_args("INSERT INTO events VALUES (?, ?, ?)", args));
+    args[2] = "text in an untyped column";
+    CHECK(sqlite->query_with_args("INSERT INTO events VALUES (?, ?, ?)", args));
+
+    Array rows = sqlite->query_fetch_rows("SELECT * FROM events");
+    REQUIRE(rows.size() == 2);
+    const Dictionary first = rows[0];
+    CHECK(int64_t(first["id"]) == int64_t(1) << 40);
+    CHECK(String(first["label"]) == String::utf8("héllo"));
+    CHECK(double(first["extra"]) == 2.5);
+    CHECK(String(Dictionary(rows[1])["extra"]) == "text in an untyped column");
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Text decoding") {
+    const char* samples[] = {
+        "",
+        "short",
+        "a longer ASCII value that spans several sixteen byte blocks",
+        "Caf\xC3\xA9 au lait, \xC3\xA9v\xC3\xA9nement num\xC3\xA9ro 42 and some ASCII after it",
+        "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE3\x83\x86\xE3\x82\xAD\xE3\x82\xB9\xE3\x83\x88 \xF0\x9F\x98\x80",
+        "\xEF\xBB\xBFwith a byte order mark",
+    };
+    for (const char* sample : samples) {
+        CHECK(SQLiteUtils::decode_utf8(sample, strlen(sample)) == String::utf8(sample, strlen(sample)));
+    }
+    // String::utf8() stops at NUL.
+    const char nul[] = "before the NUL byte\0after";
+    CHECK(SQLiteUtils::decode_utf8(nul, sizeof(nul) - 1) == "before the NUL byte");
+
+    ERR_PRINT_OFF;
+    const char* invalid = "sixteen bytes ok\xC0\xAF overlong, \xED\xA0\x80 surrogate";
+    CHECK(SQLiteUtils::decode_utf8(invalid, strlen(invalid)) == String::utf8(invalid, strlen(invalid)));
+    ERR_PRINT_ON;
+}
+
+// Compares SQLiteUtils::decode_utf8() with String::utf8() on text typical of
+// game data: short identifiers, ASCII sentences, mostly-ASCII accented text
+// and CJK. Skipped by default; run with --test-case="*Benchmark*" --no-skip.
+TEST_CASE("[Modules][SQLiteBinding][Benchmark] Text decoding" * doctest::skip()) {
+    struct Mix {
+        const char* name;
+        const char* text;
+    };
+    const Mix mixes[] = {
+        { "identifiers", "item_sword_03" },
+        { "ascii", "The old bridge creaks as you cross it; something moves in the water below." },
+        { "accented", "Caf\xC3\xA9 du march\xC3\xA9: \xC3\xA9p\xC3\xA9" "e rouill\xC3\xA9" "e, 12 pi\xC3\xA8" "ces d'or" },
+        { "cjk", "\xE5\x8F\xA4\xE3\x81\x84\xE6\xA9\x8B\xE3\x82\x92\xE6\xB8\xA1\xE3\x82\x8B\xE3\x81\xA8\xE3\x80\x81"
+                 "\xE6\xB0\xB4\xE3\x81\xAE\xE4\xB8\xAD\xE3\x81\xA7\xE4\xBD\x95\xE3\x81\x8B\xE3\x81\x8C\xE5\x8B\x95\xE3\x81\x84\xE3\x81\x9F" },
+    };
+    const int iterations = 200000;
+    for (const Mix& mix : mixes) {
+        const int length = strlen(mix.text);
+        int64_t total = 0;
+        uint64_t start = OS::get_singleton()->get_ticks_usec();
+        for (int i = 0; i < iterations; ++i) {
+            total += SQLiteUtils::decode_utf8(mix.text, length).length();
+        }
+        const double simd = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+        start = OS::get_singleton()->get_ticks_usec();
+        for (int i = 0; i < iterations; ++i) {
+            total -= String::utf8(mix.text, length).length();
+        }
+        const double reference = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+        CHECK(total == 0);
+        print_line(vformat("%s (%d bytes): decode_utf8 %.2f ms, String::utf8 %.2f ms", mix.name, length, simd,
+            reference));
+    }
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Blob compression") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    sqlite->set_blob_compression_mode(FileAccess::COMPRESSION_ZSTD);
+    sqlite->set_blob_compression_threshold(64);
+    CHECK(sqlite->query("CREATE TABLE chunks (id INTEGER PRIMARY KEY, data BLOB)"));
+
+    PackedByteArray large;
+    large.resize(4096);
+    for (int i = 0; i < large.size(); ++i) {
+        large.set(i, i % 16);
+    }
+    PackedByteArray small;
+    small.push_back(1);
+    small.push_back(2);
+
+    Array args;
+    args.push_back(large);
+    CHECK(sqlite->query_with_args("INSERT INTO chunks (data) VALUES (?)", args));
+    args[0] = small;
+    CHECK(sqlite->query_with_args("INSERT INTO chunks (data) VALUES (?)", args));
+
+    Array sizes = sqlite->query_fetch_rows("SELECT length(data) AS stored, length(decompress(data)) AS size FROM chunks ORDER BY id");
+    REQUIRE(sizes.size() == 2);
+    CHECK(int(Dictionary(sizes[0])["stored"]) < 4096);
+    CHECK(int(Dictionary(sizes[0])["size"]) == 4096);
+    CHECK(int(Dictionary(sizes[1])["stored"]) == 2);
+
+    Array rows = sqlite->query_fetch_rows("SELECT data FROM chunks ORDER BY id");
+    REQUIRE(rows.size() == 2);
+    CHECK(PackedByteArray(Dictionary(rows[0])["data"]) == large);
+    CHECK(PackedByteArray(Dictionary(rows[1])["data"]) == small);
+
+    // Raw blobs that start like a compressed one, here claiming 4 GiB, come
+    // back as they are.
+    CHECK(sqlite->query("DELETE FROM chunks"));
+    CHECK(sqlite->query("INSERT INTO chunks (data) VALUES (X'89475A02FFFFFFFF00000000000000')"));
+    rows = sqlite->query_fetch_rows("SELECT data, length(decompress(data)) AS size FROM chunks");
+    REQUIRE(rows.size() == 1);
+    CHECK(PackedByteArray(Dictionary(rows[0])["data"]).size() == 15);
+    CHECK(int(Dictionary(rows[0])["size"]) == 15);
+
+    // Blobs compressing beyond the ratio a header may claim are stored raw.
+    PackedByteArray zeros;
+    zeros.resize(1 << 20);
+    zeros.fill(0);
+    args[0] = zeros;
+    CHECK(sqlite->query_with_args("INSERT INTO chunks (data) VALUES (?)", args));
+    rows = sqlite->query_fetch_rows("SELECT data, length(data) AS stored FROM chunks WHERE length(data) > 15");
+    REQUIRE(rows.size() == 1);
+    CHECK(int(Dictionary(rows[0])["stored"]) == zeros.size());
+    CHECK(PackedByteArray(Dictionary(rows[0])["data"]) == zeros);
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Blob compression on another connection") {
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove("blobs.sqlite");
+    PackedByteArray large;
+    large.resize(4096);
+    for (int i = 0; i < large.size(); ++i) {
+        large.set(i, i % 16);
+    }
+    Array args;
+    args.push_back(large);
+
+    Ref<SQLiteBinding> writer = memnew(SQLiteBinding);
+    REQUIRE(writer->open("blobs.sqlite"));
+    writer->set_blob_compression_mode(FileAccess::COMPRESSION_ZSTD);
+    CHECK(writer->query("CREATE TABLE chunks (data BLOB)"));
+    CHECK(writer->query_with_args("INSERT INTO chunks (data) VALUES (?)", args));
+    CHECK(writer->close());
+
+    // Stored blobs carry their own header, so reading needs no setup.
+    Ref<SQLiteBinding> reader = memnew(SQLiteBinding);
+    REQUIRE(reader->open("blobs.sqlite"));
+    CHECK(reader->get_blob_compression_mode() < 0);
+    Array rows = reader->query_fetch_rows("SELECT data, length(data) AS stored FROM chunks");
+    REQUIRE(rows.size() == 1);
+    CHECK(int(Dictionary(rows[0])["stored"]) < 4096);
+    CHECK(PackedByteArray(Dictionary(rows[0])["data"]) == large);
+    Ref<SQLiteRowSet> row_set = reader->query_fetch_row_set("SELECT data FROM chunks", Array());
+    REQUIRE(row_set.is_valid());
+    CHECK(PackedByteArray(row_set->get_value(0, 0)) == large);
+    CHECK(reader->close());
+    dir->remove("blobs.sqlite");
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Sorter settings") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->get_worker_threads() == 0);
+    CHECK(sqlite->set_worker_threads(4));
+    CHECK(sqlite->get_worker_threads() == 4);
+    CHECK(Dictionary(sqlite->query_fetch_rows("PRAGMA threads")[0])["threads"] == Variant(4));
+    CHECK(sqlite->set_temp_store(SQLiteBinding::TEMP_STORE_MEMORY));
+    CHECK(Dictionary(sqlite->query_fetch_rows("PRAGMA temp_store")[0])["temp_store"] == Variant(2));
+    CHECK(sqlite->set_cache_size(64 * 1024));
+    CHECK(Dictionary(sqlite->query_fetch_rows("PRAGMA cache_size")[0])["cache_size"] == Variant(-64 * 1024));
+
+    // SCsub raises SQLITE_MAX_WORKER_THREADS to 16; more are clamped.
+    ERR_PRINT_OFF;
+    CHECK_FALSE(sqlite->set_worker_threads(64));
+    ERR_PRINT_ON;
+    CHECK(sqlite->get_worker_threads() == 16);
+
+    // A sort that spills out of a small cache, so the sorter hands runs to
+    // its helper threads.
+    CHECK(sqlite->set_worker_threads(4));
+    CHECK(sqlite->set_cache_size(256));
+    CHECK(sqlite->execute_script("CREATE TABLE keys (k INTEGER, pad BLOB);"
+                                 "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 200000) "
+                                 "INSERT INTO keys SELECT (x * 7919) % 200003, zeroblob(32) FROM n;"));
+    const PackedInt64Array sorted = sqlite->query_fetch_columns("SELECT k FROM keys ORDER BY k")["k"];
+    REQUIRE(sorted.size() == 200000);
+    bool ordered = true;
+    for (int i = 1; i < sorted.size(); ++i) {
+        ordered = ordered && sorted[i - 1] <= sorted[i];
+    }
+    CHECK(ordered);
+    CHECK(sqlite->close());
+}
+
+// Times a large ORDER BY and CREATE INDEX for several sorter thread limits.
+// Skipped by default; run with --test-case="*Benchmark*" --no-skip.
+TEST_CASE("[Modules][SQLiteBinding][Benchmark] Sorter threads" * doctest::skip()) {
+    const String path = "benchmark_sorter.sqlite";
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove(path);
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open(path));
+    CHECK(sqlite->execute_script("CREATE TABLE keys (k INTEGER, name TEXT);"
+                                 "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 2000000) "
+                                 "INSERT INTO keys SELECT (x * 7919) % 2000003, 'key_' || (x % 1009) FROM n;"));
+    CHECK(sqlite->set_cache_size(8 * 1024));
+
+    const int thread_counts[] = { 0, 1, 2, 4, 8 };
+    for (int threads : thread_counts) {
+        CHECK(sqlite->set_worker_threads(threads));
+        uint64_t start = OS::get_singleton()->get_ticks_usec();
+        CHECK(sqlite->query("CREATE TABLE sorted AS SELECT * FROM keys ORDER BY k, name"));
+        const double order_by = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+        start = OS::get_singleton()->get_ticks_usec();
+        CHECK(sqlite->query("CREATE INDEX keys_name ON keys (name, k)"));
+        const double create_index = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+        print_line(vformat("%d helper threads: ORDER BY %.2f ms, CREATE INDEX %.2f ms", threads, order_by,
+            create_index));
+        CHECK(sqlite->query("DROP TABLE sorted"));
+        CHECK(sqlite->query("DROP INDEX keys_name"));
+    }
+    CHECK(sqlite->close());
+    dir->remove(path);
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Index recommendations") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE scores (player INTEGER, level INTEGER, score INTEGER)"));
+
+    PackedStringArray workload;
+    workload.push_back("SELECT score FROM scores WHERE player = ? ORDER BY level");
+    const Dictionary report = sqlite->recommend_indexes(workload);
+    const PackedStringArray indexes = report["indexes"];
+    REQUIRE(indexes.size() == 1);
+    CHECK(indexes[0].begins_with("CREATE INDEX"));
+    const Array statements = report["statements"];
+    REQUIRE(statements.size() == 1);
+    const Dictionary statement = statements[0];
+    CHECK(String(statement["plan_before"]).contains("SCAN scores"));
+    CHECK(String(statement["plan_after"]).contains("USING INDEX"));
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Planner statistics") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE scores (player INTEGER, level INTEGER)"));
+    CHECK(sqlite->query("CREATE INDEX scores_player ON scores (player)"));
+    CHECK(sqlite->export_planner_stats().is_empty());
+
+    Array stat1;
+    stat1.push_back(create_dict({{"tbl", "scores"}, {"idx", "scores_player"}, {"stat", "1000000 2"}}));
+    Dictionary stats;
+    stats["sqlite_stat1"] = stat1;
+    CHECK(sqlite->load_planner_stats(stats));
+    CHECK(Array(sqlite->export_planner_stats()["sqlite_stat1"]) == stat1);
+
+    CHECK(sqlite->optimize());
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Planner statistics with blob compression") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->execute_script("CREATE TABLE tags (name TEXT);"
+                                 "CREATE INDEX tags_name ON tags (name);"
+                                 "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 200) "
+                                 "INSERT INTO tags SELECT printf('%.200c%d', 'a', x % 20) FROM n;"
+                                 "ANALYZE;"));
+    const Dictionary stats = sqlite->export_planner_stats();
+    REQUIRE(stats.has("sqlite_stat4"));
+
+    // Samples are stored as they are, even while blobs are compressed.
+    sqlite->set_blob_compression_threshold(1);
+    sqlite->set_blob_compression_mode(FileAccess::COMPRESSION_DEFLATE);
+    CHECK(sqlite->load_planner_stats(stats));
+    Array compressed = sqlite->query_fetch_rows("SELECT count(*) AS n FROM sqlite_stat4 WHERE substr(sample, 1, 3) = x'89475A'");
+    CHECK(Dictionary(compressed[0])["n"] == Variant(0));
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Deferred optimize") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    SIGNAL_WATCH(sqlite.ptr(), "optimized");
+
+    // Only this connection reaches an in-memory database, so the optimize
+    // runs after the call instead of inside it.
+    CHECK(sqlite->optimize_async());
+    SIGNAL_CHECK_FALSE("optimized");
+    MessageQueue::get_singleton()->flush();
+    Array emitted;
+    emitted.push_back(Array());
+    SIGNAL_CHECK("optimized", emitted);
+
+    SIGNAL_UNWATCH(sqlite.ptr(), "optimized");
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Float buffer") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE instances (id INTEGER, x REAL, y REAL, shade REAL)"));
+    CHECK(sqlite->query("INSERT INTO instances VALUES (1, 1.5, 2.5, 0.5), (2, -1.0, NULL, 1.0)"));
+
+    Array layout;
+    layout.push_back("x");
+    layout.push_back("y");
+    layout.push_back(3);
+    layout.push_back(1.0);
+    const PackedFloat32Array buffer =
+            sqlite->query_into_float_buffer("SELECT * FROM instances ORDER BY id", Array(), layout);
+    REQUIRE(buffer.size() == 8);
+    CHECK(buffer[0] == 1.5f);
+    CHECK(buffer[1] == 2.5f);
+    CHECK(buffer[2] == 0.5f);
+    CHECK(buffer[3] == 1.0f);
+    CHECK(buffer[4] == -1.0f);
+    CHECK(buffer[5] == 0.0f);
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Columnar insert") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE units (id INTEGER PRIMARY KEY, hp REAL, name TEXT)"));
+
+    PackedInt64Array ids;
+    ids.push_back(3);
+    ids.push_back(1);
+    PackedFloat64Array hp;
+    hp.push_back(30.5);
+    hp.push_back(10.0);
+    PackedStringArray names;
+    names.push_back("orc");
+    names.push_back("elf");
+    Dictionary columns;
+    columns["id"] = ids;
+    columns["hp"] = hp;
+    columns["name"] = names;
+    CHECK(sqlite->insert_columns("units", columns, "id"));
+
+    Array answer;
+    answer.push_back(create_dict({{"id", 1}, {"hp", 10.0}, {"name", "elf"}}));
+    answer.push_back(create_dict({{"id", 3}, {"hp", 30.5}, {"name", "orc"}}));
+    CHECK(sqlite->query_fetch_rows("SELECT * FROM units ORDER BY rowid") == answer);
+
+    ERR_PRINT_OFF;
+    columns["id"] = ids;
+    CHECK_FALSE(sqlite->insert_columns("units", columns));
+    ERR_PRINT_ON;
+    CHECK(sqlite->query_fetch_rows("SELECT * FROM units").size() == 2);
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Columnar fetch") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE events (id INTEGER PRIMARY KEY, name TEXT, weight REAL)"));
+
+    PackedStringArray distinct;
+    distinct.push_back("spawn");
+    distinct.push_back("death");
+    PackedInt32Array codes;
+    codes.push_back(0);
+    codes.push_back(1);
+    codes.push_back(0);
+    codes.push_back(-1);
+    PackedInt64Array ids;
+    PackedFloat64Array weights;
+    for (int i = 0; i < codes.size(); ++i) {
+        ids.push_back(i + 1);
+        weights.push_back(i * 0.5);
+    }
+    Dictionary columns;
+    columns["id"] = ids;
+    columns["name"] = create_dict({{"values", distinct}, {"codes", codes}});
+    columns["weight"] = weights;
+    CHECK(sqlite->insert_columns("events", columns));
+    Array null_rows = sqlite->query_fetch_rows("SELECT id FROM events WHERE name IS NULL");
+    REQUIRE(null_rows.size() == 1);
+    CHECK(Dictionary(null_rows[0]) == create_dict({{"id", 4}}));
+
+    PackedStringArray encoded;
+    encoded.push_back("name");
+    Dictionary fetched = sqlite->query_fetch_columns("SELECT * FROM events ORDER BY id", Array(), encoded);
+    CHECK(PackedInt64Array(fetched["id"]) == ids);
+    CHECK(PackedFloat64Array(fetched["weight"]) == weights);
+    const Dictionary names = fetched["name"];
+    CHECK(PackedStringArray(names["values"]) == distinct);
+    CHECK(PackedInt32Array(names["codes"]) == codes);
+
+    fetched = sqlite->query_fetch_columns("SELECT name, count(*) AS n FROM events GROUP BY name ORDER BY name");
+    CHECK(PackedStringArray(fetched["name"]).size() == 3);
+    CHECK(Array(fetched["n"]).size() == 3);
+
+    // A value of another type turns the column into Variants rather than 0.
+    CHECK(sqlite->query("CREATE TABLE mixed (amount INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO mixed VALUES (1), (NULL), ('many')"));
+    const Array amounts = sqlite->query_fetch_columns("SELECT amount FROM mixed ORDER BY rowid")["amount"];
+    REQUIRE(amounts.size() == 3);
+    CHECK(amounts[0] == Variant(1));
+    CHECK(amounts[1].get_type() == Variant::NIL);
+    CHECK(amounts[2] == Variant("many"));
+
+    ERR_PRINT_OFF;
+    codes.set(0, 2);
+    columns["name"] = create_dict({{"values", distinct}, {"codes", codes}});
+    CHECK_FALSE(sqlite->insert_columns("events", columns));
+    ERR_PRINT_ON;
+
+    CHECK(sqlite->close());
+}
+
+// Compares fetching a wide result row by row against fetching it by column,
+// with and without dictionary encoding of the repeated text column. Skipped
+// by default; run with --test-case="*Benchmark*" --no-skip.
+TEST_CASE("[Modules][SQLiteBinding][Benchmark] Columnar fetch" * doctest::skip()) {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE events (id INTEGER PRIMARY KEY, name TEXT, weight REAL, tick INTEGER)"));
+    CHECK(sqlite->query("WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 200000) "
+                        "INSERT INTO events (name, weight, tick) SELECT 'event_' || (x % 23), x * 0.25, x * 16 FROM n"));
+
+    const String query = "SELECT * FROM events";
+    uint64_t start = OS::get_singleton()->get_ticks_usec();
+    CHECK(sqlite->query_fetch_rows(query).size() == 200000);
+    const double rows = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+    start = OS::get_singleton()->get_ticks_usec();
+    CHECK(PackedInt64Array(sqlite->query_fetch_columns(query)["id"]).size() == 200000);
+    const double columns = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+    PackedStringArray encoded;
+    encoded.push_back("name");
+    start = OS::get_singleton()->get_ticks_usec();
+    CHECK(PackedInt64Array(sqlite->query_fetch_columns(query, Array(), encoded)["id"]).size() == 200000);
+    const double dictionary = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+    print_line(vformat("200000 rows: rows %.2f ms, columns %.2f ms, dictionary columns %.2f ms", rows, columns,
+        dictionary));
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Asynchronous open") {
+    {
+        Ref<SQLiteBinding> setup = memnew(SQLiteBinding);
+        CHECK(setup->open("warmup.sqlite"));
+        CHECK(setup->query("CREATE TABLE IF NOT EXISTS items (id INTEGER PRIMARY KEY, name TEXT)"));
+        CHECK(setup->query("CREATE INDEX IF NOT EXISTS items_name ON items (name)"));
+        CHECK(setup->close());
+    }
+
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    PackedStringArray statements;
+    statements.push_back("SELECT * FROM items WHERE id = ?");
+    PackedStringArray warm;
+    warm.push_back("items");
+    warm.push_back("items_name");
+    Dictionary options;
+    options["statements"] = statements;
+    options["warm"] = warm;
+    CHECK(sqlite->open_async("warmup.sqlite", options));
+    CHECK(sqlite->is_opening());
+
+    const uint64_t deadline = OS::get_singleton()->get_ticks_msec() + 5000;
+    while (sqlite->is_opening() && OS::get_singleton()->get_ticks_msec() < deadline) {
+        OS::get_singleton()->delay_usec(1000);
+        MessageQueue::get_singleton()->flush();
+    }
+    REQUIRE_FALSE(sqlite->is_opening());
+    CHECK(sqlite->get_handle() != nullptr);
+    CHECK(sqlite->get_cached_statement("SELECT * FROM items WHERE id = ?") != nullptr);
+
+    CHECK(sqlite->query("DROP TABLE items"));
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Overlay") {
+    Ref<SQLiteBinding> base = memnew(SQLiteBinding);
+    REQUIRE(base->open("overlay_base.sqlite"));
+    CHECK(base->query("DROP TABLE IF EXISTS items"));
+    CHECK(base->query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT)"));
+    CHECK(base->query("INSERT INTO items (name) VALUES ('sword'), ('shield')"));
+    CHECK(base->close());
+
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove("overlay_delta.sqlite");
+
+    Ref<SQLiteBinding> overlay = memnew(SQLiteBinding);
+    REQUIRE(overlay->open_overlay("overlay_base.sqlite", "overlay_delta.sqlite"));
+    CHECK(overlay->query("INSERT INTO items (name) VALUES ('bow')"));
+    CHECK(overlay->query("UPDATE items SET name = 'axe' WHERE id = 1"));
+    CHECK(overlay->close());
+
+    // The base is untouched; the delta holds the changes.
+    REQUIRE(base->open("overlay_base.sqlite"));
+    Array rows = base->query_fetch_rows_with_args("SELECT name FROM items ORDER BY id", Array());
+    REQUIRE(rows.size() == 2);
+    CHECK(Dictionary(rows[0]) == create_dict({{"name", "sword"}}));
+    CHECK(base->close());
+
+    REQUIRE(overlay->open_overlay("overlay_base.sqlite", "overlay_delta.sqlite"));
+    rows = overlay->query_fetch_rows_with_args("SELECT name FROM items ORDER BY id", Array());
+    REQUIRE(rows.size() == 3);
+    CHECK(Dictionary(rows[0]) == create_dict({{"name", "axe"}}));
+    CHECK(Dictionary(rows[2]) == create_dict({{"name", "bow"}}));
+
+    // A second connection would work from a stale index of the delta.
+    Ref<SQLiteBinding> second = memnew(SQLiteBinding);
+    ERR_PRINT_OFF;
+    CHECK_FALSE(second->open_overlay("overlay_base.sqlite", "overlay_delta.sqlite"));
+    ERR_PRINT_ON;
+    CHECK(overlay->close());
+    REQUIRE(second->open_overlay("overlay_base.sqlite", "overlay_delta.sqlite"));
+    CHECK(second->close());
+
+    // A torn append that reads back as zeros would label page 0; its
+    // checksum fails, so the real first page is kept.
+    Ref<FileAccess> delta = FileAccess::open("overlay_delta.sqlite", FileAccess::READ_WRITE);
+    REQUIRE(delta.is_valid());
+    delta->seek_end();
+    Vector<uint8_t> zeros;
+    zeros.resize(16 + 4096);
+    zeros.fill(0);
+    delta->store_buffer(zeros);
+    delta.unref();
+    REQUIRE(overlay->open_overlay("overlay_base.sqlite", "overlay_delta.sqlite"));
+    rows = overlay->query_fetch_rows("PRAGMA integrity_check");
+    CHECK(Dictionary(rows[0]) == create_dict({{"integrity_check", "ok"}}));
+    CHECK(overlay->query_fetch_rows("SELECT name FROM items").size() == 3);
+    CHECK(overlay->close());
+
+    dir->remove("overlay_delta.sqlite");
+    dir->remove("overlay_base.sqlite");
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Compressed pages") {
+    Ref<SQLiteBinding> source = memnew(SQLiteBinding);
+    REQUIRE(source->open(":memory:"));
+    CHECK(source->query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT)"));
+    CHECK(source->query("WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 2000) "
+                        "INSERT INTO items (name) SELECT 'item ' || (x % 10) FROM n"));
+    CHECK(source->save_compressed("compressed.sqlite"));
+    CHECK(source->close());
+
+    Ref<SQLiteBinding> shipped = memnew(SQLiteBinding);
+    REQUIRE(shipped->open_compressed("compressed.sqlite", true));
+    Array rows = shipped->query_fetch_rows_with_args("SELECT count(*) AS n FROM items", Array());
+    REQUIRE(rows.size() == 1);
+    CHECK(Dictionary(rows[0]) == create_dict({{"n", 2000}}));
+    // Writes fail on a read-only open and leave the rows alone.
+    shipped->query("DELETE FROM items");
+    rows = shipped->query_fetch_rows_with_args("SELECT count(*) AS n FROM items", Array());
+    CHECK(Dictionary(rows[0]) == create_dict({{"n", 2000}}));
+    CHECK(shipped->close());
+
+    Ref<SQLiteBinding> save = memnew(SQLiteBinding);
+    REQUIRE(save->open_compressed("compressed.sqlite"));
+    CHECK(save->query("DELETE FROM items WHERE id > 10"));
+    CHECK(save->close());
+    REQUIRE(save->open_compressed("compressed.sqlite"));
+    rows = save->query_fetch_rows_with_args("SELECT count(*) AS n FROM items", Array());
+    CHECK(Dictionary(rows[0]) == create_dict({{"n", 10}}));
+    rows = save->query_fetch_rows_with_args("PRAGMA integrity_check", Array());
+    CHECK(Dictionary(rows[0]) == create_dict({{"integrity_check", "ok"}}));
+    // A second writer would work from a stale page index.
+    Ref<SQLiteBinding> second = memnew(SQLiteBinding);
+    ERR_PRINT_OFF;
+    CHECK_FALSE(second->open_compressed("compressed.sqlite"));
+    ERR_PRINT_ON;
+    CHECK(save->close());
+
+    DirAccess::create(DirAccess::ACCESS_FILESYSTEM)->remove("compressed.sqlite");
+}
+
+// Compares file size against point lookup and scan latency for each
+// compression mode. Skipped by default; run with --test-case="*Benchmark*"
+// --no-skip.
+TEST_CASE("[Modules][SQLiteBinding][Benchmark] Compressed pages" * doctest::skip()) {
+    const String plain_path = "benchmark_plain.sqlite";
+    const String compressed_path = "benchmark_compressed.sqlite";
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove(plain_path);
+    Ref<SQLiteBinding> source = memnew(SQLiteBinding);
+    REQUIRE(source->open(plain_path));
+    CHECK(source->query("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, description TEXT, value INTEGER)"));
+    CHECK(source->query("WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 50000) "
+                        "INSERT INTO items (name, description, value) SELECT 'item_' || (x % 97), "
+                        "'A ' || (x % 13) || ' handed weapon of tier ' || (x % 7) || ' found in region ' || (x % 31), "
+                        "x * 37 % 1000 FROM n"));
+    CHECK(source->query("CREATE INDEX items_value ON items (value)"));
+
+    const uint64_t plain_size = FileAccess::open(plain_path, FileAccess::READ)->get_length();
+    const auto measure = [&](const Ref<SQLiteBinding>& db, const String& label, uint64_t size) {
+        CHECK(db->query("PRAGMA cache_size = -2000"));
+        uint64_t start = OS::get_singleton()->get_ticks_usec();
+        for (int i = 0; i < 2000; ++i) {
+            Array args;
+            args.push_back(i * 7919 % 50000 + 1);
+            CHECK(db->query_fetch_rows_with_args("SELECT name FROM items WHERE id = ?", args).size() == 1);
+        }
+        const double lookup = (OS::get_singleton()->get_ticks_usec() - start) / 2000.0;
+        start = OS::get_singleton()->get_ticks_usec();
+        CHECK(db->query_fetch_rows("SELECT sum(length(description)) FROM items").size() == 1);
+        const double scan = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0;
+        print_line(vformat("%s: %d bytes (%.1f%%), lookup %.2f us, scan %.2f ms", label, size,
+            100.0 * size / plain_size, lookup, scan));
+    };
+    measure(source, "plain", plain_size);
+
+    const int modes[] = { FileAccess::COMPRESSION_FASTLZ, FileAccess::COMPRESSION_DEFLATE,
+        FileAccess::COMPRESSION_ZSTD, FileAccess::COMPRESSION_GZIP };
+    const char* names[] = { "fastlz", "deflate", "zstd", "gzip" };
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(source->save_compressed(compressed_path, modes[i]));
+        const uint64_t size = FileAccess::open(compressed_path, FileAccess::READ)->get_length();
+        Ref<SQLiteBinding> compressed = memnew(SQLiteBinding);
+        REQUIRE(compressed->open_compressed(compressed_path, true));
+        measure(compressed, names[i], size);
+        CHECK(compressed->close());
+    }
+    CHECK(source->close());
+    dir->remove(compressed_path);
+    dir->remove(plain_path);
+}
+
+// A page that moves is labelled in its new record before the old record is
+// freed. Appending the page's previous record after the current one leaves
+// the file as a crash between the two writes would, with the stale copy at
+// the higher offset.
+TEST_CASE("[Modules][SQLiteBinding] Compressed pages crash recovery") {
+    const String path = "compressed_crash.sqlite";
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove(path);
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open_compressed(path));
+    CHECK(sqlite->query("CREATE TABLE items (name TEXT)"));
+    CHECK(sqlite->query("INSERT INTO items VALUES ('old')"));
+    CHECK(sqlite->close());
+    const Vector<uint8_t> before = FileAccess::get_file_as_bytes(path);
+    REQUIRE(sqlite->open_compressed(path));
+    CHECK(sqlite->query("UPDATE items SET name = 'new'"));
+    CHECK(sqlite->close());
+    Vector<uint8_t> after = FileAccess::get_file_as_bytes(path);
+
+    // The header keeps the end of the records at 24 and the index at 32;
+    // a label is the page number, sequence number, stored size and capacity.
+    const uint64_t header_size = 64;
+    const uint64_t label_size = 24;
+    int64_t record = -1;
+    uint64_t record_size = 0;
+    for (uint64_t offset = header_size; offset + label_size <= decode_uint64(before.ptr() + 24);) {
+        const uint64_t size = label_size + decode_uint32(before.ptr() + offset + 20);
+        if (decode_uint64(before.ptr() + offset) == 1) {
+            record = offset;
+            record_size = size;
+        }
+        offset += size;
+    }
+    REQUIRE(record >= 0);
+    const uint64_t data_end = decode_uint64(after.ptr() + 24);
+    after.resize(MAX(uint64_t(after.size()), data_end + record_size));
+    memcpy(after.ptrw() + data_end, before.ptr() + record, record_size);
+    encode_uint64(data_end + record_size, after.ptrw() + 24);
+    encode_uint64(0, after.ptrw() + 32);
+    encode_uint64(0, after.ptrw() + 40);
+    Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+    REQUIRE(file.is_valid());
+    file->store_buffer(after);
+    file.unref();
+
+    REQUIRE(sqlite->open_compressed(path));
+    Array rows = sqlite->query_fetch_rows("SELECT name FROM items");
+    REQUIRE(rows.size() == 1);
+    CHECK(Dictionary(rows[0]) == create_dict({{"name", "new"}}));
+    rows = sqlite->query_fetch_rows("PRAGMA integrity_check");
+    CHECK(Dictionary(rows[0]) == create_dict({{"integrity_check", "ok"}}));
+    CHECK(sqlite->close());
+    dir->remove(path);
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Compressed pages damaged header") {
+    const String path = "compressed_header.sqlite";
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove(path);
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open_compressed(path));
+    CHECK(sqlite->query("CREATE TABLE items (name TEXT)"));
+    CHECK(sqlite->close());
+    const Vector<uint8_t> original = FileAccess::get_file_as_bytes(path);
+
+    // The header keeps the page size at 8 and the compression mode at 12.
+    const auto open_damaged = [&](uint64_t offset, uint32_t value) {
+        Vector<uint8_t> damaged = original;
+        encode_uint32(value, damaged.ptrw() + offset);
+        Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+        file->store_buffer(damaged);
+        file.unref();
+        return sqlite->open_compressed(path, true);
+    };
+    ERR_PRINT_OFF;
+    CHECK_FALSE(open_damaged(8, 1000));
+    CHECK_FALSE(open_damaged(8, 1 << 20));
+    CHECK_FALSE(open_damaged(12, 99));
+    ERR_PRINT_ON;
+    CHECK(open_damaged(8, decode_uint32(original.ptr() + 8)));
+    CHECK(sqlite->close());
+    dir->remove(path);
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Memory resident") {
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove("resident.sqlite");
+    Ref<SQLiteBinding> file = memnew(SQLiteBinding);
+    REQUIRE(file->open("resident.sqlite"));
+    CHECK(file->query("CREATE TABLE state (id INTEGER PRIMARY KEY, hp INTEGER)"));
+    CHECK(file->query("INSERT INTO state VALUES (1, 100)"));
+    CHECK(file->close());
+
+    Ref<SQLiteBinding> resident = memnew(SQLiteBinding);
+    REQUIRE(resident->open_memory_resident("resident.sqlite", 60000));
+    CHECK(resident->query("UPDATE state SET hp = 90 WHERE id = 1"));
+    CHECK(resident->query("INSERT INTO state VALUES (2, 50)"));
+    CHECK(resident->persist());
+
+    REQUIRE(file->open("resident.sqlite"));
+    Array rows = file->query_fetch_rows("SELECT hp FROM state ORDER BY id");
+    REQUIRE(rows.size() == 2);
+    CHECK(Dictionary(rows[0]) == create_dict({{"hp", 90}}));
+    CHECK(file->close());
+
+    // A full copy only ever holds committed changes.
+    CHECK(resident->query("BEGIN"));
+    CHECK(resident->query("CREATE TABLE draft (x INTEGER)"));
+    ERR_PRINT_OFF;
+    CHECK_FALSE(resident->persist());
+    ERR_PRINT_ON;
+    CHECK(resident->query("ROLLBACK"));
+    CHECK(resident->persist());
+    REQUIRE(file->open("resident.sqlite"));
+    rows = file->query_fetch_rows("SELECT name FROM sqlite_schema WHERE name = 'draft'");
+    CHECK(rows.is_empty());
+    CHECK(file->close());
+
+    // Schema changes are written as a full copy, on close at the latest.
+    CHECK(resident->query("CREATE TABLE log (message TEXT)"));
+    CHECK(resident->query("INSERT INTO log VALUES ('saved')"));
+    CHECK(resident->close());
+
+    REQUIRE(file->open("resident.sqlite"));
+    rows = file->query_fetch_rows("SELECT message FROM log");
+    REQUIRE(rows.size() == 1);
+    CHECK(Dictionary(rows[0]) == create_dict({{"message", "saved"}}));
+    CHECK(file->close());
+    dir->remove("resident.sqlite");
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Snapshots") {
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove("snapshot.sqlite");
+    Ref<SQLiteBinding> writer = memnew(SQLiteBinding);
+    REQUIRE(writer->open("snapshot.sqlite"));
+    CHECK(writer->query("PRAGMA journal_mode = WAL"));
+    CHECK(writer->query("CREATE TABLE scores (value INTEGER)"));
+    CHECK(writer->query("INSERT INTO scores VALUES (1)"));
+
+    Ref<SQLiteBinding> holder = memnew(SQLiteBinding);
+    REQUIRE(holder->open("snapshot.sqlite"));
+    Ref<SQLiteSnapshot> snapshot = holder->snapshot_get();
+    REQUIRE(snapshot.is_valid());
+
+    CHECK(writer->query("INSERT INTO scores VALUES (2)"));
+
+    Ref<SQLiteBinding> reader = memnew(SQLiteBinding);
+    REQUIRE(reader->open("snapshot.sqlite"));
+    CHECK(reader->snapshot_open(snapshot));
+    Array rows = reader->query_fetch_rows("SELECT count(*) AS n FROM scores");
+    CHECK(Dictionary(rows[0]) == create_dict({{"n", 1}}));
+    CHECK(reader->snapshot_close());
+    rows = reader->query_fetch_rows("SELECT count(*) AS n FROM scores");
+    CHECK(Dictionary(rows[0]) == create_dict({{"n", 2}}));
+    ERR_PRINT_OFF;
+    CHECK_FALSE(reader->snapshot_close());
+    ERR_PRINT_ON;
+
+    Ref<SQLiteSnapshot> newer = reader->snapshot_get();
+    REQUIRE(newer.is_valid());
+    CHECK(snapshot->compare(newer) < 0);
+
+    // Neither connection is left in a read transaction, so a checkpoint can
+    // reset the whole WAL.
+    rows = writer->query_fetch_rows("PRAGMA wal_checkpoint(TRUNCATE)");
+    REQUIRE(rows.size() == 1);
+    CHECK(int(Dictionary(rows[0])["busy"]) == 0);
+
+    CHECK(reader->close());
+    CHECK(holder->close());
+    CHECK(writer->close());
+    dir->remove("snapshot.sqlite");
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Checkpoints") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE entities (id INTEGER PRIMARY KEY, x REAL)"));
+    CHECK(sqlite->query("INSERT INTO entities VALUES (1, 0.0), (2, 0.0)"));
+    REQUIRE(sqlite->enable_checkpoints(3));
+
+    const int64_t first = sqlite->checkpoint();
+    CHECK(sqlite->query("UPDATE entities SET x = x + 1"));
+    const int64_t second = sqlite->checkpoint();
+    CHECK(sqlite->query("DELETE FROM entities WHERE id = 2"));
+    CHECK(sqlite->query("INSERT INTO entities VALUES (3, 5.0)"));
+    CHECK(sqlite->checkpoint() == second + 1);
+    CHECK(sqlite->query("UPDATE entities SET x = 10"));
+
+    CHECK(sqlite->rollback_to_checkpoint(second));
+    Array rows = sqlite->query_fetch_rows("SELECT id, x FROM entities ORDER BY id");
+    REQUIRE(rows.size() == 2);
+    CHECK(Dictionary(rows[1]) == create_dict({{"id", 2}, {"x", 1.0}}));
+
+    CHECK(sqlite->rollback_to_checkpoint(first));
+    rows = sqlite->query_fetch_rows("SELECT sum(x) AS total FROM entities");
+    CHECK(double(Dictionary(rows[0])["total"]) == 0.0);
+    CHECK(sqlite->get_latest_checkpoint() == first);
+
+    // Only the last three can be restored.
+    for (int i = 0; i < 3; ++i) {
+        sqlite->checkpoint();
+    }
+    CHECK(sqlite->get_oldest_checkpoint() == sqlite->get_latest_checkpoint() - 2);
+    CHECK_FALSE(sqlite->rollback_to_checkpoint(first));
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Table mirror") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE items (code TEXT UNIQUE, damage INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO items VALUES ('sword', 10), ('bow', 6)"));
+    REQUIRE(sqlite->mirror_table("items", "code"));
+    CHECK(sqlite->mirror_get("items", "sword") == create_dict({{"code", "sword"}, {"damage", 10}}));
+    CHECK(sqlite->mirror_get("items", "axe").is_empty());
+
+    CHECK(sqlite->query("UPDATE items SET code = 'longbow', damage = 8 WHERE code = 'bow'"));
+    CHECK(sqlite->query("INSERT INTO items VALUES ('axe', 12)"));
+    CHECK(sqlite->query("DELETE FROM items WHERE code = 'sword'"));
+    CHECK(sqlite->mirror_get("items", "bow").is_empty());
+    CHECK(sqlite->mirror_get("items", "longbow") == create_dict({{"code", "longbow"}, {"damage", 8}}));
+    CHECK(sqlite->mirror_get("items", "axe") == create_dict({{"code", "axe"}, {"damage", 12}}));
+    CHECK(sqlite->mirror_get("items", "sword").is_empty());
+
+    CHECK(sqlite->query("BEGIN"));
+    CHECK(sqlite->query("UPDATE items SET damage = 99 WHERE code = 'axe'"));
+    CHECK(int(sqlite->mirror_get("items", "axe")["damage"]) == 99);
+    CHECK(sqlite->query("ROLLBACK"));
+    CHECK(int(sqlite->mirror_get("items", "axe")["damage"]) == 12);
+
+    // ROLLBACK TO does not call the rollback hook.
+    CHECK(sqlite->query("SAVEPOINT edit"));
+    CHECK(sqlite->query("UPDATE items SET damage = 99 WHERE code = 'axe'"));
+    CHECK(int(sqlite->mirror_get("items", "axe")["damage"]) == 99);
+    CHECK(sqlite->query("ROLLBACK TO edit"));
+    CHECK(int(sqlite->mirror_get("items", "axe")["damage"]) == 12);
+    CHECK(sqlite->query("RELEASE edit"));
+    CHECK(int(sqlite->mirror_get("items", "axe")["damage"]) == 12);
+
+    // insert_columns() rolls back to its savepoint when a row fails.
+    PackedStringArray codes;
+    codes.push_back("dagger");
+    codes.push_back("axe");
+    Dictionary columns;
+    columns["code"] = codes;
+    ERR_PRINT_OFF;
+    CHECK_FALSE(sqlite->insert_columns("items", columns));
+    ERR_PRINT_ON;
+    CHECK(sqlite->mirror_get("items", "dagger").is_empty());
+
+    // DELETE without WHERE reports every row instead of truncating.
+    CHECK(sqlite->query("DELETE FROM items"));
+    CHECK(sqlite->mirror_get("items", "longbow").is_empty());
+    CHECK(sqlite->mirror_get("items", "axe").is_empty());
+
+    // REPLACE deletes the row holding the key under its old rowid without
+    // reporting it. A new row reusing that rowid must not evict the key.
+    CHECK(sqlite->query("INSERT INTO items VALUES ('sword', 10)"));
+    CHECK(sqlite->mirror_get("items", "sword") == create_dict({{"code", "sword"}, {"damage", 10}}));
+    const Array old_rowid = sqlite->query_fetch_rows("SELECT rowid AS id FROM items WHERE code = 'sword'");
+    CHECK(sqlite->query("INSERT OR REPLACE INTO items VALUES ('sword', 11)"));
+    CHECK(sqlite->mirror_get("items", "sword") == create_dict({{"code", "sword"}, {"damage", 11}}));
+    CHECK(sqlite->query_with_args("INSERT INTO items (rowid, code, damage) VALUES (?, 'bow', 6)",
+        Dictionary(old_rowid[0]).values()));
+    CHECK(sqlite->mirror_get("items", "bow") == create_dict({{"code", "bow"}, {"damage", 6}}));
+    CHECK(sqlite->mirror_get("items", "sword") == create_dict({{"code", "sword"}, {"damage", 11}}));
+    sqlite->unmirror_table("items");
+
+    // REPLACE on another unique column, or a column hiding the rowid, would
+    // leave stale rows behind.
+    CHECK(sqlite->query("CREATE TABLE players (name TEXT UNIQUE, slot INTEGER UNIQUE)"));
+    CHECK(sqlite->query("CREATE TABLE shadowed (oid TEXT, name TEXT UNIQUE)"));
+    ERR_PRINT_OFF;
+    CHECK_FALSE(sqlite->mirror_table("players", "name"));
+    CHECK_FALSE(sqlite->mirror_table("shadowed", "name"));
+    ERR_PRINT_ON;
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteBinding] Row set") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    REQUIRE(sqlite->open(":memory:"));
+    CHECK(sqlite->execute_script("CREATE TABLE units (id INTEGER, name TEXT, speed REAL, icon BLOB, note TEXT);"
+                                 "INSERT INTO units VALUES (1, 'scout', 2.5, x'0102', NULL);"
+                                 "INSERT INTO units VALUES (2, 'tank', 0.5, NULL, 'slow');"));
+
+    Array args;
+    args.push_back(0);
+    Ref<SQLiteRowSet> rows = sqlite->query_fetch_row_set("SELECT * FROM units WHERE id > ? ORDER BY id", args);
+    REQUIRE(rows.is_valid());
+    CHECK(rows->get_row_count() == 2);
+    CHECK(rows->get_column_count() == 5);
+    CHECK(rows->get_column_index("speed") == 2);
+    CHECK(String(rows->get_value(0, "name")) == "scout");
+    CHECK(double(rows->get_value(1, 2)) == 0.5);
+    CHECK(PackedByteArray(rows->get_value(0, "icon")).size() == 2);
+    CHECK(rows->get_value(0, "note").get_type() == Variant::NIL);
+    CHECK(rows->get_value(0, "missing").get_type() == Variant::NIL);
+
+    Ref<SQLiteRow> row = rows->get_row(1);
+    REQUIRE(row.is_valid());
+    CHECK(int(row->get("id")) == 2);
+    CHECK(String(row->get_value("note")) == "slow");
+    CHECK(row->to_dictionary() == create_dict({{"id", 2}, {"name", "tank"}, {"speed", 0.5}, {"note", "slow"}}));
+    CHECK(rows->get_row_dictionary(1) == Dictionary(sqlite->query_fetch_rows("SELECT * FROM units WHERE id = 2")[0]));
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteLiveQuery]") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE scores (id INTEGER PRIMARY KEY, score INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO scores VALUES (1, 10), (2, 20)"));
+
+    Ref<SQLiteLiveQuery> live = memnew(SQLiteLiveQuery);
+    CHECK(live->setup(sqlite, "SELECT * FROM scores ORDER BY id", Array(), "id"));
+    CHECK(live->get_tables().has("scores"));
+    CHECK(live->get_rows().size() == 2);
+    CHECK_FALSE(live->is_dirty());
+
+    CHECK(sqlite->query("UPDATE scores SET score = 30 WHERE id = 2"));
+    CHECK(live->is_dirty());
+    CHECK(live->refresh());
+    CHECK(Dictionary(live->get_rows()[1]) == create_dict({{"id", 2}, {"score", 30}}));
+
+    CHECK(sqlite->query("CREATE TABLE other (id INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO other VALUES (1)"));
+    CHECK_FALSE(live->is_dirty());
+
+    // WITHOUT ROWID tables fire no update hook, and rows need distinct keys.
+    CHECK(sqlite->query("CREATE TABLE tags (name TEXT PRIMARY KEY) WITHOUT ROWID"));
+    ERR_PRINT_OFF;
+    CHECK_FALSE(live->setup(sqlite, "SELECT * FROM tags", Array(), "name"));
+    CHECK_FALSE(live->setup(sqlite, "SELECT score FROM scores", Array(), "id"));
+    CHECK(sqlite->query("INSERT INTO scores VALUES (3, 30)"));
+    CHECK_FALSE(live->setup(sqlite, "SELECT score FROM scores", Array(), "score"));
+    ERR_PRINT_ON;
+
+    live.unref();
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteLiveQuery] Signals") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE scores (id INTEGER PRIMARY KEY, score INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO scores VALUES (1, 10), (2, 20)"));
+
+    Ref<SQLiteLiveQuery> live = memnew(SQLiteLiveQuery);
+    CHECK(live->setup(sqlite, "SELECT * FROM scores ORDER BY id", Array(), "id"));
+    SIGNAL_WATCH(live.ptr(), "rows_added");
+    SIGNAL_WATCH(live.ptr(), "rows_removed");
+    SIGNAL_WATCH(live.ptr(), "rows_changed");
+
+    // Each signal is emitted once per refresh, with an Array of rows.
+    const auto emitted = [](const Array& rows) {
+        Array arguments;
+        arguments.push_back(rows);
+        Array emissions;
+        emissions.push_back(arguments);
+        return emissions;
+    };
+
+    CHECK(sqlite->query("INSERT INTO scores VALUES (3, 5)"));
+    CHECK(live->refresh());
+    Array rows;
+    rows.push_back(create_dict({{"id", 3}, {"score", 5}}));
+    SIGNAL_CHECK("rows_added", emitted(rows));
+    SIGNAL_CHECK_FALSE("rows_removed");
+    SIGNAL_CHECK_FALSE("rows_changed");
+
+    CHECK(sqlite->query("UPDATE scores SET score = 11 WHERE id = 1"));
+    CHECK(live->refresh());
+    rows.clear();
+    rows.push_back(create_dict({{"id", 1}, {"score", 11}}));
+    SIGNAL_CHECK("rows_changed", emitted(rows));
+    SIGNAL_CHECK_FALSE("rows_added");
+    SIGNAL_CHECK_FALSE("rows_removed");
+
+    CHECK(sqlite->query("DELETE FROM scores WHERE id = 2"));
+    CHECK(live->refresh());
+    rows.clear();
+    rows.push_back(create_dict({{"id", 2}, {"score", 20}}));
+    SIGNAL_CHECK("rows_removed", emitted(rows));
+    SIGNAL_CHECK_FALSE("rows_added");
+    SIGNAL_CHECK_FALSE("rows_changed");
+
+    // Without WHERE, SQLite would truncate the table without reporting rows.
+    CHECK(sqlite->query("DELETE FROM scores"));
+    CHECK(live->is_dirty());
+    CHECK(live->refresh());
+    CHECK(live->get_rows().is_empty());
+    rows.clear();
+    rows.push_back(create_dict({{"id", 1}, {"score", 11}}));
+    rows.push_back(create_dict({{"id", 3}, {"score", 5}}));
+    SIGNAL_CHECK("rows_removed", emitted(rows));
+
+    SIGNAL_UNWATCH(live.ptr(), "rows_added");
+    SIGNAL_UNWATCH(live.ptr(), "rows_removed");
+    SIGNAL_UNWATCH(live.ptr(), "rows_changed");
+    live.unref();
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteUnitOfWork]") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    CHECK(sqlite->query("CREATE TABLE items (resource_name TEXT PRIMARY KEY, resource_local_to_scene INTEGER)"));
+    CHECK(sqlite->query("INSERT INTO items VALUES ('sword', 0), ('shield', 0)"));
+
+    Array items = sqlite->query_fetch_objects("SELECT * FROM items ORDER BY resource_name", Array(), "Resource");
+    REQUIRE(items.size() == 2);
+    Ref<SQLiteUnitOfWork> work = memnew(SQLiteUnitOfWork);
+    work->set_database(sqlite);
+    CHECK(work->track_all(items, "items", "resource_name"));
+    CHECK(work->get_tracked_count() == 2);
+
+    Ref<Resource> shield = items[0];
+    CHECK_FALSE(work->is_dirty(shield.ptr()));
+    shield->set_local_to_scene(true);
+    CHECK(work->is_dirty(shield.ptr()));
+
+    Ref<Resource> bow = memnew(Resource);
+    bow->set_name("bow");
+    bow->set_local_to_scene(true);
+    CHECK(work->add(bow.ptr(), "items", "resource_name"));
+
+    CHECK(work->flush());
+    CHECK_FALSE(work->is_dirty(shield.ptr()));
+    CHECK_FALSE(work->is_dirty(bow.ptr()));
+    Array answer;
+    answer.push_back(create_dict({{"resource_name", "bow"}, {"resource_local_to_scene", 1}}));
+    answer.push_back(create_dict({{"resource_name", "shield"}, {"resource_local_to_scene", 1}}));
+    answer.push_back(create_dict({{"resource_name", "sword"}, {"resource_local_to_scene", 0}}));
+    CHECK(sqlite->query_fetch_rows("SELECT * FROM items ORDER BY resource_name") == answer);
+
+    // Flushing joins a transaction the caller already has open.
+    Ref<Resource> sword = items[1];
+    sword->set_local_to_scene(true);
+    CHECK(sqlite->query("BEGIN"));
+    CHECK(work->flush());
+    CHECK(sqlite->query("COMMIT"));
+    CHECK(sqlite->query_fetch_rows("SELECT resource_name FROM items WHERE resource_local_to_scene = 1").size() == 3);
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteTyped]") {
+    Ref<SQLiteBinding> sqlite = memnew(SQLiteBinding);
+    CHECK(sqlite->open(":memory:"));
+    SQLiteBinding& db = *sqlite.ptr();
+    CHECK(SQLiteTyped::exec(db, "CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT, rating REAL)"));
+    CHECK(SQLiteTyped::exec(db, "INSERT INTO players VALUES (?, ?, ?)", int64_t(1) << 40, "ann", 1.5));
+    CHECK(SQLiteTyped::exec(db, "INSERT INTO players VALUES (?, ?, ?)", 2, String("bob"), nullptr));
+
+    LocalVector<std::tuple<int64_t, String, double>> rows =
+            SQLiteTyped::query<int64_t, String, double>(db, "SELECT * FROM players WHERE id > ? ORDER BY id", 0);
+    REQUIRE(rows.size() == 2);
+    CHECK(std::get<0>(rows[0]) == 2);
+    CHECK(std::get<1>(rows[1]) == "ann");
+    CHECK(std::get<0>(rows[1]) == int64_t(1) << 40);
+
+    struct Player {
+        int64_t id = 0;
+        String name;
+    };
+    LocalVector<Player> players = SQLiteTyped::query_into(db, SQLiteTyped::fields(&Player::id, &Player::name),
+            "SELECT id, name FROM players ORDER BY id");
+    REQUIRE(players.size() == 2);
+    CHECK(players[0].name == "bob");
+
+    ERR_PRINT_OFF;
+    CHECK(SQLiteTyped::query<int64_t>(db, "SELECT * FROM players").is_empty());
+    CHECK_FALSE(SQLiteTyped::exec(db, "DELETE FROM players WHERE id = ?"));
+    ERR_PRINT_ON;
+
+    CHECK(sqlite->close());
+}
+
+TEST_CASE("[Modules][SQLiteConnectionManager]") {
+    Ref<SQLiteConnectionManager> manager = memnew(SQLiteConnectionManager);
+    manager->set_max_open_handles(2);
+
+    Ref<SQLiteBinding> first = manager->acquire("player_1.sqlite");
+    REQUIRE(first.is_valid());
+    CHECK(first->query("CREATE TABLE IF NOT EXISTS inventory (item TEXT)"));
+    manager->release("player_1.sqlite");
+    first.unref();
+
+    CHECK(manager->acquire("player_1.sqlite").is_valid());
+    manager->release("player_1.sqlite");
+    CHECK(manager->acquire("player_2.sqlite").is_valid());
+    manager->release("player_2.sqlite");
+    CHECK(manager->acquire("player_3.sqlite").is_valid());
+    manager->release("player_3.sqlite");
+
+    // player_1 was the least recently used idle handle.
+    Dictionary metrics = manager->get_metrics();
+    CHECK(int(metrics["open"]) == 2);
+    CHECK(int(metrics["hits"]) == 1);
+    CHECK(int(metrics["opens"]) == 3);
+    CHECK(int(metrics["evictions"]) == 1);
+
+    manager->set_idle_timeout(0);
+    CHECK(manager->close_idle() == 2);
+    CHECK(manager->get_open_count() == 0);
+
+    Ref<SQLiteBinding> cleanup = memnew(SQLiteBinding);
+    CHECK(cleanup->open("player_1.sqlite"));
+    CHECK(cleanup->query("DROP TABLE IF EXISTS inventory"));
+    CHECK(cleanup->close());
+}
+
+TEST_CASE("[Modules][SQLiteShardSet]") {
+    Ref<SQLiteShardSet> shard_set = memnew(SQLiteShardSet);
+    PackedStringArray paths;
+    paths.push_back("shard_a.sqlite");
+    paths.push_back("shard_b.sqlite");
+    shard_set->set_paths(paths);
+    CHECK(shard_set->get_shard_count() == 2);
+
+    CHECK(shard_set->execute("CREATE TABLE IF NOT EXISTS sales (region TEXT, amount INTEGER)", Array()));
+    CHECK(shard_set->execute("DELETE FROM sales", Array()));
+    Array args;
+    args.push_back("north");
+    args.push_back(10);
+    CHECK(shard_set->execute("INSERT INTO sales VALUES (?, ?)", args));
+    args[0] = "south";
+    args[1] = 5;
+    CHECK(shard_set->execute("INSERT INTO sales VALUES (?, ?)", args));
+
+    Dictionary options;
+    options["order_by"] = "amount";
+    options["descending"] = true;
+    options["limit"] = 3;
+    Array top = shard_set->query("SELECT * FROM sales ORDER BY amount DESC LIMIT 3", Array(), options);
+    REQUIRE(top.size() == 3);
+    CHECK(int(Dictionary(top[0])["amount"]) == 10);
+    CHECK(int(Dictionary(top[2])["amount"]) == 5);
+    // ORDER BY and LIMIT are added to each shard's query.
+    top = shard_set->query("SELECT * FROM sales;", Array(), options);
+    REQUIRE(top.size() == 3);
+    CHECK(int(Dictionary(top[0])["amount"]) == 10);
+    CHECK(int(Dictionary(top[2])["amount"]) == 5);
+
+    ERR_PRINT_OFF;
+    // A shard that fails to step fails the whole query.
+    CHECK(shard_set->query("SELECT amount, abs(-9223372036854775807 - 1) FROM sales", Array()).is_empty());
+    CHECK_FALSE(shard_set->execute("INSERT INTO sales VALUES ('west', abs(-9223372036854775807 - 1))", Array()));
+    ERR_PRINT_ON;
+
+    Dictionary aggregates;
+    aggregates["total"] = "sum";
+    aggregates["biggest"] = "max";
+    options = Dictionary();
+    options["aggregates"] = aggregates;
+    options["group_by"] = "region";
+    options["order_by"] = "region";
+    Array totals = shard_set->query(
+        "SELECT region, sum(amount) AS total, max(amount) AS biggest FROM sales GROUP BY region", Array(), options);
+    REQUIRE(totals.size() == 2);
+    CHECK(Dictionary(totals[0]) == create_dict({{"region", "north"}, {"total", 20}, {"biggest", 10}}));
+    CHECK(Dictionary(totals[1]) == create_dict({{"region", "south"}, {"total", 10}, {"biggest", 5}}));
+
+    CHECK(shard_set->execute("DROP TABLE sales", Array()));
+    shard_set->close();
+}
+
+TEST_CASE("[Modules][SQLQueryLibrary]") {
+    Ref<SQLQueryLibrary> library = memnew(SQLQueryLibrary);
+    CHECK(library->parse("-- name: add_player\n"
+                         "INSERT INTO players VALUES (?, ?);\n"
+                         "\n"
+                         "-- name: get_player\n"
+                         "SELECT name FROM players\n"
+                         "WHERE id = ?;\n") == OK);
+    CHECK(library->get_query_names().size() == 2);
+    CHECK(library->get_query("get_player") == "SELECT name FROM players\nWHERE id = ?;");
+    CHECK(library->parse("-- name: a\nSELECT 1;\n-- name: a\nSELECT 2;\n") == ERR_PARSE_ERROR);
+    CHECK(library->has_query("add_player"));
+
+    Ref<SQLiteBinding> db = memnew(SQLiteBinding);
+    REQUIRE(db->open(":memory:"));
+    CHECK(db->execute_script("CREATE TABLE players (id INTEGER PRIMARY KEY, name TEXT);"));
+    db->set_query_library(library);
+    CHECK(db->prepare_library());
+
+    Array args;
+    args.push_back(7);
+    args.push_back("Ada");
+    CHECK(db->run("add_player", args).is_empty());
+    args.resize(1);
+    Array rows = db->run("get_player", args);
+    REQUIRE(rows.size() == 1);
+    CHECK(Dictionary(rows[0]) == create_dict({{"name", "Ada"}}));
+
+    Ref<SQLQueryLibrary> broken = memnew(SQLQueryLibrary);
+    CHECK(broken->parse("-- name: typo\nSELECT nme FROM players;\n") == OK);
+    db->set_query_library(broken);
+    CHECK_FALSE(db->prepare_library());
+    db->close();
+}
+
+TEST_CASE("[Modules][SQLiteKV]") {
+    Ref<SQLiteBinding> db = memnew(SQLiteBinding);
+    REQUIRE(db->open(":memory:"));
+    Ref<SQLiteKV> kv = memnew(SQLiteKV);
+    REQUIRE(kv->setup(db, "settings"));
+
+    CHECK(kv->put("audio/volume", 0.5));
+    CHECK(kv->put("audio/muted", false));
+    CHECK(kv->put("video/size", Vector2i(1280, 720)));
+    CHECK(kv->put("audio/volume", 0.75));
+    CHECK(double(kv->get_value("audio/volume")) == doctest::Approx(0.75));
+    CHECK(kv->get_value("video/size") == Variant(Vector2i(1280, 720)));
+    CHECK(int(kv->get_value("missing", 3)) == 3);
+
+    Dictionary many;
+    many["input/jump"] = "space";
+    many["input/fire"] = "ctrl";
+    CHECK(kv->put_many(many));
+    PackedStringArray keys;
+    keys.push_back("input/jump");
+    keys.push_back("missing");
+    CHECK(kv->get_many(keys) == create_dict({{"input/jump", "space"}}));
+
+    Dictionary audio = kv->scan_prefix("audio/");
+    CHECK(audio.size() == 2);
+    CHECK(String(audio.keys()[0]) == "audio/muted");
+    CHECK(kv->scan_prefix("input/", 1).size() == 1);
+    CHECK(kv->scan_prefix("").size() == 5);
+
+    CHECK(kv->erase("audio/muted"));
+    CHECK(kv->get_value("audio/muted").get_type() == Variant::NIL);
+    db->close();
+}
+
+// Compares saving one changed setting through SQLiteKV with rewriting the
+// whole settings file as JSON, as a ConfigFile or JSON save would. Skipped
+// by default; run with --test-case="*Benchmark*" --no-skip.
+TEST_CASE("[Modules][SQLiteKV][Benchmark] Per-key writes" * doctest::skip()) {
+    const String db_path = "benchmark_kv.sqlite";
+    const String json_path = "benchmark_kv.json";
+    Ref<DirAccess> dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+    dir->remove(db_path);
+    Ref<SQLiteBinding> db = memnew(SQLiteBinding);
+    REQUIRE(db->open(db_path));
+    Ref<SQLiteKV> kv = memnew(SQLiteKV);
+    REQUIRE(kv->setup(db));
+
+    const int key_count = 10000;
+    Dictionary settings;
+    for (int i = 0; i < key_count; ++i) {
+        settings[vformat("section_%d/key_%d", i % 50, i)] = vformat("value %d", i);
+    }
+    CHECK(kv->put_many(settings));
+
+    const int writes = 200;
+    uint64_t start = OS::get_singleton()->get_ticks_usec();
+    for (int i = 0; i < writes; ++i) {
+        CHECK(kv->put(vformat("section_%d/key_%d", i % 50, i * 37 % key_count), i));
+    }
+    const double per_key = (OS::get_singleton()->get_ticks_usec() - start) / double(writes);
+
+    start = OS::get_singleton()->get_ticks_usec();
+    for (int i = 0; i < writes; ++i) {
+        settings[vformat("section_%d/key_%d", i % 50, i * 37 % key_count)] = i;
+        Ref<FileAccess> file = FileAccess::open(json_path, FileAccess::WRITE);
+        REQUIRE(file.is_valid());
+        file->store_string(JSON::stringify(settings));
+    }
+    const double rewrite = (OS::get_singleton()->get_ticks_usec() - start) / double(writes);
+    print_line(vformat("%d keys: per-key put %.2f us, full rewrite %.2f us", key_count, per_key, rewrite));
+
+    CHECK(db->close());
+    dir->remove(db_path);
+    dir->remove(json_path);
+}
+
 }